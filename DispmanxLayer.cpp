@@ -96,28 +96,31 @@ DispmanxLayer::DispmanxLayer(int bytesperpixel, Rectangle dest_rect, Dimension s
 	vc_dispmanx_rect_set(&(m_bmpRect), 0, 0, src_image.width, src_image.height);
 	vc_dispmanx_rect_set(&(srcRect), 0 << 16, 0 << 16, src_image.width << 16, src_image.height << 16);
 	vc_dispmanx_rect_set(&(dstRect), dest_rect.x, dest_rect.y, dest_rect.width, dest_rect.height);
+	m_dstRect = dstRect;
 
 	// Image vars
 	m_image_pitch = src_image.width * bytesperpixel;
 
-	// create image resource
-	uint vc_image_ptr;
-	m_resource = vc_dispmanx_resource_create(
-		imagetype,
-		src_image.width | (m_image_pitch << 16),
-		src_image.height | (src_image.height << 16),
-		&vc_image_ptr);
-	assert(m_resource != 0);
-
-	// set palette is necessary
-	if(imagetype == VC_IMAGE_8BPP) {
-		int palette[256]; // ARGB 256
-		palette[0] = 0x00000000; // transparent background
-		palette[1] = 0xFF000000; // black outline
-		palette[2] = 0xFFFFFFFF; // white text
-		palette[3] = 0xFF7F7F7F; // gray
-
-		vc_dispmanx_resource_set_palette( m_resource, palette, 0, sizeof palette );
+	// create image resources
+	for(DISPMANX_RESOURCE_HANDLE_T &resource : m_resources) {
+		uint vc_image_ptr;
+		resource = vc_dispmanx_resource_create(
+			imagetype,
+			src_image.width | (m_image_pitch << 16),
+			src_image.height | (src_image.height << 16),
+			&vc_image_ptr);
+		assert(resource != 0);
+
+		// set palette is necessary
+		if(imagetype == VC_IMAGE_8BPP) {
+			int palette[256]; // ARGB 256
+			palette[0] = 0x00000000; // transparent background
+			palette[1] = 0xFF000000; // black outline
+			palette[2] = 0xFFFFFFFF; // white text
+			palette[3] = 0xFF7F7F7F; // gray
+
+			vc_dispmanx_resource_set_palette( resource, palette, 0, sizeof palette );
+		}
 	}
 
 	// Position currently empty image on screen
@@ -127,7 +130,7 @@ DispmanxLayer::DispmanxLayer(int bytesperpixel, Rectangle dest_rect, Dimension s
 	VC_DISPMANX_ALPHA_T alpha = { DISPMANX_FLAGS_ALPHA_FROM_SOURCE, 255, 0 };
 
 	m_element = vc_dispmanx_element_add(m_update, s_display, -30,
-		&(dstRect), m_resource, &(srcRect),
+		&(dstRect), m_resources[m_front], &(srcRect),
 		DISPMANX_PROTECTION_NONE, &alpha, NULL, DISPMANX_NO_ROTATE);
 
 	assert(m_element != 0);
@@ -150,6 +153,34 @@ void DispmanxLayer::changeImageLayer(int new_layer)
 	assert( ret == 0 );
 }
 
+// Puts the back resource on screen with the given rects, and raises the
+// layer if show is set, all in one update so they land on the same frame
+void DispmanxLayer::showBackResource(VC_RECT_T *dst_rect, VC_RECT_T *src_rect, bool show)
+{
+	uint32_t change = ELEMENT_CHANGE_DEST_RECT | ELEMENT_CHANGE_SRC_RECT;
+	int layer = 0;
+	if(show && m_element_is_hidden) {
+		change |= ELEMENT_CHANGE_LAYER;
+		layer = s_layer + 1;
+	}
+
+	m_update = vc_dispmanx_update_start(0);
+	assert(m_update != 0);
+
+	int ret = vc_dispmanx_element_change_attributes(m_update, m_element,
+		change, layer, 255, dst_rect, src_rect, 0, DISPMANX_NO_ROTATE);
+	assert( ret == 0 );
+
+	ret = vc_dispmanx_element_change_source(m_update, m_element, m_resources[!m_front]);
+	assert( ret == 0 );
+
+	ret = vc_dispmanx_update_submit_sync( m_update );
+	assert( ret == 0 );
+
+	m_front = !m_front;
+	if(show) m_element_is_hidden = false;
+}
+
 void DispmanxLayer::hideElement()
 {
 	if(m_element_is_hidden) return;
@@ -157,13 +188,6 @@ void DispmanxLayer::hideElement()
 	m_element_is_hidden = true;
 }
 
-void DispmanxLayer::showElement()
-{
-	if(!m_element_is_hidden) return;
-	changeImageLayer(s_layer + 1);
-	m_element_is_hidden = false;
-}
-
 void DispmanxLayer::clearImage()
 {
 	int size = m_image_pitch * m_bmpRect.height;
@@ -180,16 +204,39 @@ void DispmanxLayer::clearImage()
 void DispmanxLayer::setImageData(void *image_data, bool show)
 {
 	// the palette param is ignored
-	int result = vc_dispmanx_resource_write_data(m_resource,
+	int result = vc_dispmanx_resource_write_data(m_resources[!m_front],
 		VC_IMAGE_MIN, m_image_pitch, image_data, &(m_bmpRect));
 
 	assert(result == 0);
 
-	result = vc_dispmanx_element_change_source(m_update, m_element, m_resource);
+	VC_RECT_T srcRect;
+	vc_dispmanx_rect_set(&(srcRect), 0, 0, m_bmpRect.width << 16, m_bmpRect.height << 16);
+	showBackResource(&(m_dstRect), &(srcRect), show);
+}
+
+// copy an image covering only rect of the layer and show just that part.
+// image_data has it in the top left corner, in rows of the layer's pitch.
+void DispmanxLayer::setImageData(void *image_data, Rectangle rect, bool show)
+{
+	// only whole rows can be written, from the top of the resource
+	VC_RECT_T rows;
+	vc_dispmanx_rect_set(&(rows), 0, 0, m_bmpRect.width, rect.height);
+
+	int result = vc_dispmanx_resource_write_data(m_resources[!m_front],
+		VC_IMAGE_MIN, m_image_pitch, image_data, &(rows));
 
 	assert(result == 0);
 
-	if(show) showElement();
+	// the source may be scaled to the destination
+	int sw = m_bmpRect.width, sh = m_bmpRect.height;
+	int dw = m_dstRect.width, dh = m_dstRect.height;
+
+	VC_RECT_T srcRect;
+	VC_RECT_T dstRect;
+	vc_dispmanx_rect_set(&(srcRect), 0, 0, rect.width << 16, rect.height << 16);
+	vc_dispmanx_rect_set(&(dstRect), m_dstRect.x + rect.x * dw / sw, m_dstRect.y + rect.y * dh / sh,
+		rect.width * dw / sw, rect.height * dh / sh);
+	showBackResource(&(dstRect), &(srcRect), show);
 }
 
 const int& DispmanxLayer::getSourceWidth()
@@ -215,6 +262,8 @@ DispmanxLayer::~DispmanxLayer()
 	result = vc_dispmanx_update_submit_sync(m_update);
 	assert(result == 0);
 
-	result = vc_dispmanx_resource_delete(m_resource);
-	assert(result == 0);
+	for(DISPMANX_RESOURCE_HANDLE_T resource : m_resources) {
+		result = vc_dispmanx_resource_delete(resource);
+		assert(result == 0);
+	}
 }
@@ -41,9 +41,11 @@ public:
 	void hideElement();
 	void clearImage();
 	void setImageData(void *image_data, bool show = true);
+	void setImageData(void *image_data, Rectangle rect, bool show = true);
 
 	const int& getSourceWidth();
 	const int& getSourceHeight();
+	int getPitch() { return m_image_pitch; }
 
 	static void openDisplay(int display_num, int layer);
 	static Dimension getScreenDimensions();
@@ -51,11 +53,14 @@ public:
 
 private:
 	void changeImageLayer(int new_layer);
-	void showElement();
+	void showBackResource(VC_RECT_T *dst_rect, VC_RECT_T *src_rect, bool show);
 
 	VC_RECT_T m_bmpRect;
+	VC_RECT_T m_dstRect;
 	int m_image_pitch;
-	DISPMANX_RESOURCE_HANDLE_T m_resource;
+	// Images are written to the resource not on screen, then swapped in
+	DISPMANX_RESOURCE_HANDLE_T m_resources[2];
+	int m_front = 0;
 	DISPMANX_ELEMENT_HANDLE_T m_element;
 	DISPMANX_UPDATE_HANDLE_T m_update;
 
@@ -192,3 +192,24 @@ void KeyConfig::parseConfigFile(char *filepath, map<int,int> &keymap)
         }
     }
 }
+
+/* Whether the action moves the playback position, so that a seek still
+ * in progress can give way to it
+ */
+bool KeyConfig::isSeekAction(int action)
+{
+    switch(action)
+    {
+        case ACTION_PREVIOUS_CHAPTER:
+        case ACTION_NEXT_CHAPTER:
+        case ACTION_SEEK_BACK_SMALL:
+        case ACTION_SEEK_FORWARD_SMALL:
+        case ACTION_SEEK_BACK_LARGE:
+        case ACTION_SEEK_FORWARD_LARGE:
+        case ACTION_SEEK_RELATIVE:
+        case ACTION_SEEK_ABSOLUTE:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -57,4 +57,5 @@ class KeyConfig
 
     static void buildDefaultKeymap(std::map<int, int> &keymap);
     static void parseConfigFile(char *filepath, std::map<int, int> &keymap);
+    static bool isSeekAction(int action);
 };
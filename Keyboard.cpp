@@ -8,9 +8,11 @@
 #include <fcntl.h>
 #include <dbus/dbus.h>
 #include <errno.h>
+#include <poll.h>
 
 #include "utils/log.h"
 #include "Keyboard.h"
+#include "OMXClock.h"
 
 Keyboard::Keyboard() 
 {
@@ -45,8 +47,9 @@ Keyboard::Keyboard()
   }
 
   dbus_threads_init_default();
-  Create();
+  m_event_loop = NULL;
   m_action = -1;
+  Create();
 }
 
 Keyboard::~Keyboard() 
@@ -104,8 +107,14 @@ void Keyboard::Process()
 
     if (m_keymap[ch[0]] != 0)
           send_action(m_keymap[ch[0]]);
-    else
+    else if (feof(stdin))
       Sleep(20);
+    else
+    {
+      // Return as soon as a key arrives rather than polling stdin
+      struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+      poll(&pfd, 1, 20);
+    }
   }
 }
 
@@ -116,11 +125,19 @@ int Keyboard::getEvent()
   return ret;
 }
 
+int Keyboard::peekEvent()
+{
+  return m_action;
+}
+
 void Keyboard::send_action(int action) 
 {
   DBusMessage *message = NULL, *reply = NULL;
   DBusError error;
+  int64_t sent;
   m_action = action;
+  if (m_event_loop)
+    m_event_loop->Wake();
   if (!conn)
     return;
 
@@ -137,11 +154,16 @@ void Keyboard::send_action(int action)
 
   dbus_message_append_args(message, DBUS_TYPE_INT32, &action, DBUS_TYPE_INVALID);
   
+  sent = OMXClock::GetAbsoluteClock();
   reply = dbus_connection_send_with_reply_and_block(conn, message, -1, &error);
 
   if (!reply || dbus_error_is_set(&error))
     goto fail;
 
+  // The player replies when its main loop picks the action up
+  CLog::Log(LOGDEBUG, "Keyboard: action %d handled in %.1f ms", action,
+            (OMXClock::GetAbsoluteClock() - sent) * 1e-3);
+
   dbus_message_unref(message);
   dbus_message_unref(reply);
 
@@ -171,6 +193,11 @@ void Keyboard::setDbusName(const std::string &dbus_name)
   m_dbus_name = dbus_name;
 }
 
+void Keyboard::setEventLoop(OMXEventLoop *event_loop)
+{
+  m_event_loop = event_loop;
+}
+
 int Keyboard::dbus_connect() 
 {
   DBusError error;
@@ -3,6 +3,7 @@
 #define OMXPLAYER_DBUS_INTERFACE_PLAYER "org.mpris.MediaPlayer2.Player"
 
 #include "OMXThread.h"
+#include "OMXEventLoop.h"
 #include <map>
 
  class Keyboard : public OMXThread
@@ -14,6 +15,7 @@
   DBusConnection *conn;
   std::map<int,int> m_keymap;
   std::string m_dbus_name;
+  OMXEventLoop *m_event_loop;
  public:
   Keyboard();
   ~Keyboard();
@@ -21,8 +23,11 @@
   void Process();
   void setKeymap(const std::map<int,int> &keymap);
   void setDbusName(const std::string &dbus_name);
+  void setEventLoop(OMXEventLoop *event_loop);
   void Sleep(unsigned int dwMilliSeconds);
   int getEvent();
+  // The action getEvent would return, without taking it
+  int peekEvent();
  private:
   void restore_term();
   void send_action(int action);
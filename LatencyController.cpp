@@ -0,0 +1,94 @@
+#include <math.h>
+
+#include "LatencyController.h"
+#include "utils/log.h"
+
+#define STATS_INTERVAL 10000000 // [us]
+
+LatencyController::LatencyController()
+{
+  m_target        = 0.7f;
+  m_max_deviation = 0.01f;
+  // 5% speed per second of error, with an integral gain that keeps the
+  // loop (the buffer integrates speed error) close to critically damped
+  m_kp            = 0.05f;
+  m_ki            = 0.001f;
+  // smooths the jitter of the fifo based latency estimate
+  m_tau           = 1.0f;
+  m_stats_time    = 0;
+  Reset(m_target);
+}
+
+void LatencyController::Reset(float latency)
+{
+  m_latency      = latency;
+  m_integral     = 0.0f;
+  m_speed        = 1.0f;
+  m_last_time    = 0;
+  m_samples      = 0;
+  m_error_sum    = 0.0;
+  m_error_sq_sum = 0.0;
+  m_error_max    = 0.0f;
+  m_saturated    = 0;
+}
+
+float LatencyController::Update(float latency, int64_t now)
+{
+  float dt = m_last_time ? (now - m_last_time) * 1e-6f : 0.0f;
+  m_last_time = now;
+  if (dt < 0.0f || dt > 1.0f)
+    dt = 0.0f;
+
+  m_latency += (latency - m_latency) * (dt / (m_tau + dt));
+
+  float error = m_latency - m_target;
+  float deviation = m_kp * error + m_integral;
+  bool saturated = fabsf(deviation) > m_max_deviation;
+
+  // only integrate while the output has headroom, or the error unwinds it
+  if (!saturated || error * m_integral < 0.0f)
+    m_integral += m_ki * error * dt;
+  if (m_integral > m_max_deviation)
+    m_integral = m_max_deviation;
+  else if (m_integral < -m_max_deviation)
+    m_integral = -m_max_deviation;
+
+  deviation = m_kp * error + m_integral;
+  if (deviation > m_max_deviation)
+    deviation = m_max_deviation;
+  else if (deviation < -m_max_deviation)
+    deviation = -m_max_deviation;
+  m_speed = 1.0f + deviation;
+
+  m_samples++;
+  m_error_sum += error;
+  m_error_sq_sum += (double)error * error;
+  if (fabsf(error) > m_error_max)
+    m_error_max = fabsf(error);
+  if (saturated)
+    m_saturated++;
+
+  if (!m_stats_time)
+    m_stats_time = now;
+  else if (now - m_stats_time >= STATS_INTERVAL)
+    LogStats(now);
+
+  return m_speed;
+}
+
+void LatencyController::LogStats(int64_t now)
+{
+  if (m_samples)
+  {
+    double mean = m_error_sum / m_samples;
+    double rms = sqrt(m_error_sq_sum / m_samples);
+    CLog::Log(LOGINFO, "LatencyController: target %.2fs latency %.3fs error mean %+.3fs rms %.3fs max %.3fs, speed %.4f integral %+.4f, saturated %u/%u",
+      m_target, m_latency, mean, rms, m_error_max, m_speed, m_integral, m_saturated, m_samples);
+  }
+  m_stats_time   = now;
+  m_samples      = 0;
+  m_error_sum    = 0.0;
+  m_error_sq_sum = 0.0;
+  m_error_max    = 0.0f;
+  m_saturated    = 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+// Keeps the buffered latency of a live stream at a target by nudging the
+// clock speed. A PI controller on the low-passed latency error, with the
+// output clamped to the allowed speed deviation and the integral frozen
+// while clamped (anti-windup).
+class LatencyController
+{
+public:
+  LatencyController();
+  void SetTarget(float target) { m_target = target; }
+  void SetMaxDeviation(float max_deviation) { m_max_deviation = max_deviation; }
+  float GetTarget() { return m_target; }
+  // Restart from a known latency, e.g. after coming out of buffering
+  void Reset(float latency);
+  // Feeds a latency sample [s] taken at now [us], returns the clock speed
+  float Update(float latency, int64_t now);
+  float GetLatency() { return m_latency; }
+
+private:
+  void LogStats(int64_t now);
+
+  float   m_target;
+  float   m_max_deviation;
+  float   m_kp;
+  float   m_ki;
+  float   m_tau;
+  float   m_latency;
+  float   m_integral;
+  float   m_speed;
+  int64_t m_last_time;
+
+  // error statistics since the last log
+  int64_t m_stats_time;
+  unsigned int m_samples;
+  double  m_error_sum;
+  double  m_error_sq_sum;
+  float   m_error_max;
+  unsigned int m_saturated;
+};
@@ -30,6 +30,7 @@
 #endif
 
 #include <algorithm>
+#include <vector>
 
 using namespace std;
 
@@ -111,6 +112,28 @@ bool COMXAudio::PortSettingsChanged()
     if(!m_omx_render_analog.Initialize("OMX.alsa.audio_render", OMX_IndexParamAudioInit))
       return false;
   }
+  if (m_config.device == "omx:null")
+  {
+    if(!m_omx_render_analog.Initialize("OMX.alsa.null_render", OMX_IndexParamAudioInit))
+      return false;
+  }
+  if (m_config.device == "omx:wav")
+  {
+    if(!m_omx_render_analog.Initialize("OMX.alsa.wav_render", OMX_IndexParamAudioInit))
+      return false;
+
+    std::vector<OMX_U8> uri_buf(sizeof(OMX_PARAM_CONTENTURITYPE) + m_config.subdevice.length());
+    OMX_PARAM_CONTENTURITYPE *uri = (OMX_PARAM_CONTENTURITYPE *)&uri_buf[0];
+    OMX_INIT_STRUCTURE(*uri);
+    uri->nSize = uri_buf.size();
+    strcpy((char *)uri->contentURI, m_config.subdevice.c_str());
+    omx_err = m_omx_render_analog.SetParameter(OMX_IndexParamContentURI, uri);
+    if(omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "%s::%s - error m_omx_render_analog SetParameter omx_err(0x%08x)", CLASSNAME, __func__, omx_err);
+      return false;
+    }
+  }
 
   UpdateAttenuation();
 
@@ -234,7 +257,7 @@ bool COMXAudio::PortSettingsChanged()
 
     OMX_CONFIG_BRCMAUDIODESTINATIONTYPE audioDest;
     OMX_INIT_STRUCTURE(audioDest);
-    strncpy((char *)audioDest.sName, m_config.device == "omx:alsa" ? m_config.subdevice.c_str() : "local", sizeof(audioDest.sName));
+    strncpy((char *)audioDest.sName, m_config.device == "omx:alsa" || m_config.device == "omx:null" ? m_config.subdevice.c_str() : "local", sizeof(audioDest.sName));
     omx_err = m_omx_render_analog.SetConfig(OMX_IndexConfigBrcmAudioDestination, &audioDest);
     if (omx_err != OMX_ErrorNone)
     {
@@ -27,8 +27,12 @@
 
 #include "utils/PCMRemap.h"
 
+#include <algorithm>
+
 // the size of the audio_render output port buffers
 #define AUDIO_DECODE_OUTPUT_BUFFER (32*1024)
+// frame size assumed for codecs that do not report a fixed one
+#define AUDIO_DECODE_MAX_FRAME_SAMPLES 8192
 static const char rounded_up_channels_shift[] = {0,0,1,2,2,3,3,3,3};
 
 COMXAudioCodecOMX::COMXAudioCodecOMX()
@@ -36,6 +40,7 @@ COMXAudioCodecOMX::COMXAudioCodecOMX()
   m_pBufferOutput = NULL;
   m_iBufferOutputAlloced = 0;
   m_iBufferOutputUsed = 0;
+  m_allocations = 0;
 
   m_pCodecContext = NULL;
   m_pConvert = NULL;
@@ -52,6 +57,8 @@ COMXAudioCodecOMX::COMXAudioCodecOMX()
 
 COMXAudioCodecOMX::~COMXAudioCodecOMX()
 {
+  if (m_allocations)
+    CLog::Log(LOGDEBUG, "COMXAudioCodecOMX: %u output buffer allocations", m_allocations);
   m_dllAvUtil.av_free(m_pBufferOutput);
   m_pBufferOutput = NULL;
   m_iBufferOutputAlloced = 0;
@@ -59,6 +66,35 @@ COMXAudioCodecOMX::~COMXAudioCodecOMX()
   Dispose();
 }
 
+// Sizes the output buffer at Open for the largest block GetData hands out,
+// so it doesn't have to grow while playing
+bool COMXAudioCodecOMX::AllocOutputBuffer()
+{
+  int channels = m_pCodecContext->channels;
+  if (channels <= 0 || channels >= (int)sizeof(rounded_up_channels_shift))
+    return false;
+
+  // GetData hands out the buffer once the next frame would take it past
+  // desired_size, so it never holds more than max(desired, one frame)
+  int desired_size = AUDIO_DECODE_OUTPUT_BUFFER * (channels * GetBitsPerSample()) >> (rounded_up_channels_shift[channels] + 4);
+  int frame_samples = m_pCodecContext->frame_size > 0 ? m_pCodecContext->frame_size : AUDIO_DECODE_MAX_FRAME_SAMPLES;
+  int frame_size = m_dllAvUtil.av_samples_get_buffer_size(NULL, channels, frame_samples, m_desiredSampleFormat, 1);
+  int size = std::max(desired_size, frame_size);
+
+  if (m_iBufferOutputAlloced >= size)
+    return true;
+
+  BYTE *buffer = (BYTE*)m_dllAvUtil.av_realloc(m_pBufferOutput, size + AV_INPUT_BUFFER_PADDING_SIZE);
+  if (!buffer)
+    return false;
+  m_pBufferOutput = buffer;
+  m_iBufferOutputAlloced = size;
+  m_allocations++;
+
+  CLog::Log(LOGDEBUG, "COMXAudioCodecOMX::AllocOutputBuffer %d bytes (frame %d samples)", size, frame_samples);
+  return true;
+}
+
 bool COMXAudioCodecOMX::Open(COMXStreamInfo &hints, enum PCMLayout layout)
 {
   AVCodec* pCodec;
@@ -130,6 +166,13 @@ bool COMXAudioCodecOMX::Open(COMXStreamInfo &hints, enum PCMLayout layout)
   m_bOpenedCodec = true;
   m_iSampleFormat = AV_SAMPLE_FMT_NONE;
   m_desiredSampleFormat = m_pCodecContext->sample_fmt == AV_SAMPLE_FMT_S16 ? AV_SAMPLE_FMT_S16 : AV_SAMPLE_FMT_FLTP;
+
+  if (!AllocOutputBuffer())
+  {
+    CLog::Log(LOGERROR,"COMXAudioCodecOMX::Open() Unable to allocate output buffer");
+    Dispose();
+    return false;
+  }
   return true;
 }
 
@@ -232,10 +275,19 @@ int COMXAudioCodecOMX::GetData(BYTE** dst, int64_t &dts, int64_t &pts)
   }
   m_frameSize = outputSize;
 
+  // only when a frame is larger than predicted at Open
   if (m_iBufferOutputAlloced < m_iBufferOutputUsed + outputSize)
   {
-     m_pBufferOutput = (BYTE*)m_dllAvUtil.av_realloc(m_pBufferOutput, m_iBufferOutputUsed + outputSize + AV_INPUT_BUFFER_PADDING_SIZE);
-     m_iBufferOutputAlloced = m_iBufferOutputUsed + outputSize;
+    BYTE *buffer = (BYTE*)m_dllAvUtil.av_realloc(m_pBufferOutput, m_iBufferOutputUsed + outputSize + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!buffer)
+    {
+      CLog::Log(LOGERROR, "COMXAudioCodecOMX::GetData - Unable to grow output buffer to %d", m_iBufferOutputUsed + outputSize);
+      m_bGotFrame = false;
+      return 0;
+    }
+    m_pBufferOutput = buffer;
+    m_iBufferOutputAlloced = m_iBufferOutputUsed + outputSize;
+    m_allocations++;
   }
 
   /* need to convert format */
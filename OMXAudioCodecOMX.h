@@ -49,6 +49,8 @@ public:
   unsigned int GetFrameSize() { return m_frameSize; }
 
 protected:
+  bool AllocOutputBuffer();
+
   AVCodecContext* m_pCodecContext;
   SwrContext*     m_pConvert;
   enum AVSampleFormat m_iSampleFormat;
@@ -59,6 +61,8 @@ protected:
   BYTE *m_pBufferOutput;
   int   m_iBufferOutputUsed;
   int   m_iBufferOutputAlloced;
+  // times the output buffer was (re)allocated, once per Open when steady
+  unsigned int m_allocations;
 
   bool m_bOpenedCodec;
 
@@ -38,8 +38,11 @@ OMXClock::OMXClock()
   m_WaitMask = 0;
   m_eState = OMX_TIME_ClockStateStopped;
   m_eClock = OMX_TIME_RefClockNone;
-  m_last_media_time = 0;
-  m_last_media_time_read = 0;
+  m_media_seq = 0;
+  m_media_time = 0;
+  m_media_host = 0;
+  m_media_speed = 0;
+  m_media_valid = false;
 
   pthread_mutex_init(&m_lock, NULL);
 }
@@ -110,18 +113,20 @@ bool OMXClock::OMXSetReferenceClock(bool has_audio, bool lock /* = true */)
     }
     m_eClock = refClock.eClock;
   }
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 
   return ret;
 }
 
-bool OMXClock::OMXInitialize()
+bool OMXClock::OMXInitialize(bool software)
 {
   m_pause       = false;
 
-  if(!m_omx_clock.Initialize("OMX.broadcom.clock", OMX_IndexParamOtherInit))
+  // The software clock runs from CLOCK_MONOTONIC and can only drive the ALSA sinks
+  const char *name = software ? "OMX.alsa.clock" : "OMX.broadcom.clock";
+  if(!m_omx_clock.Initialize(name, OMX_IndexParamOtherInit))
     return false;
 
   return true;
@@ -135,7 +140,7 @@ void OMXClock::OMXDeinitialize()
   m_omx_clock.Deinitialize();
 
   m_omx_speed = DVD_PLAYSPEED_NORMAL;
-  m_last_media_time = 0;
+  InvalidateMediaTime();
 }
 
 bool OMXClock::OMXStateExecute(bool lock /* = true */)
@@ -163,7 +168,7 @@ bool OMXClock::OMXStateExecute(bool lock /* = true */)
     }
   }
 
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 
@@ -181,7 +186,7 @@ void OMXClock::OMXStateIdle(bool lock /* = true */)
   if(m_omx_clock.GetState() != OMX_StateIdle)
     m_omx_clock.SetStateForComponent(OMX_StateIdle);
 
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 }
@@ -218,7 +223,7 @@ bool  OMXClock::OMXStop(bool lock /* = true */)
   }
   m_eState = clock.eState;
 
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 
@@ -249,7 +254,7 @@ bool OMXClock::OMXStep(int steps /* = 1 */, bool lock /* = true */)
     return false;
   }
 
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 
@@ -300,54 +305,91 @@ bool OMXClock::OMXReset(bool has_video, bool has_audio, bool lock /* = true */)
     }
   }
 
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 
   return true;
 }
 
+// Called with m_lock held, so there is only ever one writer
+void OMXClock::PublishMediaTime(int64_t pts, int64_t now)
+{
+  unsigned int seq = m_media_seq.load(std::memory_order_relaxed);
+  m_media_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  m_media_time.store(pts, std::memory_order_relaxed);
+  m_media_host.store(now, std::memory_order_relaxed);
+  m_media_speed.store(m_pause ? 0 : m_omx_speed, std::memory_order_relaxed);
+
+  m_media_seq.store(seq + 2, std::memory_order_release);
+  m_media_valid = true;
+}
+
+bool OMXClock::ReadMediaTime(int64_t &pts, int64_t &host, int &speed)
+{
+  if (!m_media_valid)
+    return false;
+
+  unsigned int seq;
+  do
+  {
+    while ((seq = m_media_seq.load(std::memory_order_acquire)) & 1)
+      ;
+    pts   = m_media_time.load(std::memory_order_relaxed);
+    host  = m_media_host.load(std::memory_order_relaxed);
+    speed = m_media_speed.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while (seq != m_media_seq.load(std::memory_order_relaxed));
+
+  return true;
+}
+
 int64_t OMXClock::OMXMediaTime(bool lock /* = true */)
 {
-  int64_t pts = 0;
   if(m_omx_clock.GetComponent() == NULL)
     return 0;
 
   int64_t now = GetAbsoluteClock();
-  if (now - m_last_media_time_read > 100000 || m_last_media_time == 0)
-  {
-    if(lock)
-      Lock();
+  int64_t pts = 0, host = 0;
+  int speed = 0;
+  bool valid = ReadMediaTime(pts, host, speed);
 
-    OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+  if (valid && now - host <= 100000)
+    return pts + (now - host) * speed / DVD_PLAYSPEED_NORMAL;
 
-    OMX_TIME_CONFIG_TIMESTAMPTYPE timeStamp;
-    OMX_INIT_STRUCTURE(timeStamp);
-    timeStamp.nPortIndex = m_omx_clock.GetInputPort();
+  if(lock)
+  {
+    // someone else is refreshing (or holds the clock), keep interpolating
+    if(!valid)
+      Lock();
+    else if(pthread_mutex_trylock(&m_lock) != 0)
+      return pts + (now - host) * speed / DVD_PLAYSPEED_NORMAL;
+  }
 
-    omx_err = m_omx_clock.GetConfig(OMX_IndexConfigTimeCurrentMediaTime, &timeStamp);
-    if(omx_err != OMX_ErrorNone)
-    {
-      CLog::Log(LOGERROR, "OMXClock::MediaTime error getting OMX_IndexConfigTimeCurrentMediaTime\n");
-      if(lock)
-        UnLock();
-      return 0;
-    }
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
 
-    pts = FromOMXTime(timeStamp.nTimestamp);
-    //CLog::Log(LOGINFO, "OMXClock::MediaTime %.2f (%.2f, %.2f)", pts, m_last_media_time, now - m_last_media_time_read);
-    m_last_media_time = pts;
-    m_last_media_time_read = now;
+  OMX_TIME_CONFIG_TIMESTAMPTYPE timeStamp;
+  OMX_INIT_STRUCTURE(timeStamp);
+  timeStamp.nPortIndex = m_omx_clock.GetInputPort();
 
+  omx_err = m_omx_clock.GetConfig(OMX_IndexConfigTimeCurrentMediaTime, &timeStamp);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "OMXClock::MediaTime error getting OMX_IndexConfigTimeCurrentMediaTime\n");
     if(lock)
       UnLock();
+    return 0;
   }
-  else
-  {
-    double speed = m_pause ? 0.0 : (double)m_omx_speed / DVD_PLAYSPEED_NORMAL;
-    pts = m_last_media_time + (now - m_last_media_time_read) * speed;
-    //CLog::Log(LOGINFO, "OMXClock::MediaTime cached %.2f (%.2f, %.2f)", pts, m_last_media_time, now - m_last_media_time_read);
-  }
+
+  pts = FromOMXTime(timeStamp.nTimestamp);
+  //CLog::Log(LOGINFO, "OMXClock::MediaTime %.2f (%.2f)", pts, now - host);
+  PublishMediaTime(pts, now);
+
+  if(lock)
+    UnLock();
+
   return pts;
 }
 
@@ -420,7 +462,7 @@ bool OMXClock::OMXMediaTime(int64_t pts, bool lock /* = true*/)
   CLog::Log(LOGDEBUG, "OMXClock::OMXMediaTime set config %s = %lld", index == OMX_IndexConfigTimeCurrentAudioReference ?
        "OMX_IndexConfigTimeCurrentAudioReference":"OMX_IndexConfigTimeCurrentVideoReference", pts);
 
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 
@@ -440,7 +482,7 @@ bool OMXClock::OMXPause(bool lock /* = true */)
     if (OMXSetSpeed(0, false, true))
       m_pause = true;
 
-    m_last_media_time = 0;
+    InvalidateMediaTime();
     if(lock)
       UnLock();
   }
@@ -460,7 +502,7 @@ bool OMXClock::OMXResume(bool lock /* = true */)
     if (OMXSetSpeed(m_omx_speed, false, true))
       m_pause = false;
 
-    m_last_media_time = 0;
+    InvalidateMediaTime();
     if(lock)
       UnLock();
   }
@@ -499,7 +541,7 @@ bool OMXClock::OMXSetSpeed(int speed, bool lock /* = true */, bool pause_resume
   if (!pause_resume)
     m_omx_speed = speed;
 
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 
@@ -536,7 +578,7 @@ bool OMXClock::HDMIClockSync(bool lock /* = true */)
     return false;
   }
 
-  m_last_media_time = 0;
+  InvalidateMediaTime();
   if(lock)
     UnLock();
 
@@ -26,6 +26,8 @@
 
 #include "OMXCore.h"
 
+#include <atomic>
+
 #define DVD_SEC_TO_MICROSEC(x) ((x)       * 1000000)
 #define DVD_MILLISEC_TO_SEC(x) ((double)(x)       * 1000)
 
@@ -61,10 +63,20 @@ protected:
   OMX_TIME_REFCLOCKTYPE m_eClock;
 private:
   COMXCoreComponent m_omx_clock;
-  int64_t            m_last_media_time;
-  int64_t            m_last_media_time_read;
+  // Media time snapshot published with a seqlock. Readers interpolate from
+  // it without m_lock; only a stale snapshot is refreshed from the clock
+  // component, by whoever holds m_lock.
+  std::atomic<unsigned int> m_media_seq;
+  std::atomic<int64_t> m_media_time;
+  std::atomic<int64_t> m_media_host;
+  std::atomic<int>     m_media_speed;
+  std::atomic<bool>    m_media_valid;
   DllAvFormat       m_dllAvFormat;
 
+  void PublishMediaTime(int64_t pts, int64_t now);
+  bool ReadMediaTime(int64_t &pts, int64_t &host, int &speed);
+  void InvalidateMediaTime() { m_media_valid = false; }
+
 public:
   OMXClock();
   ~OMXClock();
@@ -72,7 +84,7 @@ public:
   void UnLock();
   void OMXSetClockPorts(OMX_TIME_CONFIG_CLOCKSTATETYPE *clock, bool has_video, bool has_audio);
   bool OMXSetReferenceClock(bool has_audio, bool lock = true);
-  bool OMXInitialize();
+  bool OMXInitialize(bool software = false);
   void OMXDeinitialize();
   bool OMXIsPaused() { return m_pause; };
   bool OMXStop(bool lock = true);
@@ -83,8 +83,13 @@ const char *OMXControlResult::getWinArg() {
 }
 
 OMXControl::OMXControl() 
+: bus(),
+  playback_status("Playing"),
+  volume(),
+  metadata_changed(),
+  position_interval()
 {
-
+  register_handlers();
 }
 
 OMXControl::~OMXControl() 
@@ -99,6 +104,7 @@ int OMXControl::init(OMXClock *m_av_clock, OMXPlayerAudio *m_player_audio, OMXPl
   audio     = m_player_audio;
   subtitles = m_player_subtitles;
   reader    = m_omx_reader;
+  volume    = audio->GetVolume();
 
   if (dbus_connect(dbus_name) < 0)
   {
@@ -132,6 +138,38 @@ void OMXControl::dispatch()
     dbus_connection_read_write(bus, 0);
 }
 
+int OMXControl::getFd()
+{
+  int fd = -1;
+  if (!bus || !dbus_connection_get_unix_fd(bus, &fd))
+    return -1;
+  return fd;
+}
+
+// Messages already read off the socket don't make the fd readable again
+bool OMXControl::pending()
+{
+  return bus && (!queued.empty() || dbus_connection_get_dispatch_status(bus) == DBUS_DISPATCH_DATA_REMAINS);
+}
+
+bool OMXControl::seekPending()
+{
+  if (!bus)
+    return false;
+
+  dispatch();
+  while (DBusMessage *m = dbus_connection_pop_message(bus))
+    queued.push_back(m);
+
+  for (DBusMessage *m : queued)
+  {
+    const Method *method = find_method(m);
+    if (method && method->seeks && method->seeks(m))
+      return true;
+  }
+  return false;
+}
+
 int OMXControl::dbus_connect(std::string& dbus_name)
 {
   DBusError error;
@@ -179,6 +217,10 @@ fail:
 
 void OMXControl::dbus_disconnect()
 {
+    for (DBusMessage *m : queued)
+        dbus_message_unref(m);
+    queued.clear();
+
     if (bus)
     {
         dbus_connection_close(bus);
@@ -193,7 +235,14 @@ OMXControlResult OMXControl::getEvent()
     return KeyConfig::ACTION_BLANK;
 
   dispatch();
-  DBusMessage *m = dbus_connection_pop_message(bus);
+  DBusMessage *m;
+  if (!queued.empty())
+  {
+    m = queued.front();
+    queued.pop_front();
+  }
+  else
+    m = dbus_connection_pop_message(bus);
 
   if (m == NULL)
     return KeyConfig::ACTION_BLANK;
@@ -205,467 +254,248 @@ OMXControlResult OMXControl::getEvent()
   return result;
 }
 
-OMXControlResult OMXControl::handle_event(DBusMessage *m)
+static void append_boolean(DBusMessageIter *iter, dbus_bool_t b)
+{
+  dbus_message_iter_append_basic(iter, DBUS_TYPE_BOOLEAN, &b);
+}
+
+static void append_string(DBusMessageIter *iter, const char *text)
+{
+  dbus_message_iter_append_basic(iter, DBUS_TYPE_STRING, &text);
+}
+
+static void append_int64(DBusMessageIter *iter, dbus_int64_t i)
+{
+  dbus_message_iter_append_basic(iter, DBUS_TYPE_INT64, &i);
+}
+
+static void append_double(DBusMessageIter *iter, double d)
+{
+  dbus_message_iter_append_basic(iter, DBUS_TYPE_DOUBLE, &d);
+}
+
+static void append_array(DBusMessageIter *iter, const char *array[], int size)
+{
+  DBusMessageIter array_cont;
+  dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, DBUS_TYPE_STRING_AS_STRING, &array_cont);
+  for (int i = 0; i < size; i++)
+    dbus_message_iter_append_basic(&array_cont, DBUS_TYPE_STRING, &array[i]);
+  dbus_message_iter_close_container(iter, &array_cont);
+}
+
+static bool always_seeks(DBusMessage *m)
+{
+  return true;
+}
+
+static bool action_seeks(DBusMessage *m)
+{
+  int action;
+  return dbus_message_get_args(m, NULL, DBUS_TYPE_INT32, &action, DBUS_TYPE_INVALID) &&
+         KeyConfig::isSeekAction(action);
+}
+
+void OMXControl::register_handlers()
 {
   //----------------------------DBus root interface-----------------------------
   //Methods:
-  if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_ROOT, "Quit"))
+  add_method(OMXPLAYER_DBUS_INTERFACE_ROOT, "Quit", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);//Note: No reply according to MPRIS2 specs
+    c->dbus_respond_ok(m);//Note: No reply according to MPRIS2 specs
     return KeyConfig::ACTION_EXIT;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_ROOT, "Raise"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_ROOT, "Raise", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     //Does nothing
     return KeyConfig::ACTION_BLANK;
-  }
-  //Properties Get method:
-  //TODO: implement GetAll
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Get"))
-  {
-    DBusError error;
-    dbus_error_init(&error);
-
-    //Retrieve interface and property name
-    const char *interface, *property;
-    dbus_message_get_args(m, &error, DBUS_TYPE_STRING, &interface, DBUS_TYPE_STRING, &property, DBUS_TYPE_INVALID);
-    //Root interface:
-    if (strcmp(interface, OMXPLAYER_DBUS_INTERFACE_ROOT)==0)
+  });
+
+  //Properties:
+  add_property(OMXPLAYER_DBUS_INTERFACE_ROOT, {"CanRaise", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 0); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_ROOT, {"CanQuit", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 1); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_ROOT, {"CanSetFullscreen", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 0); }, NULL});
+  //Fullscreen is read/write in theory not read only, but read only at the moment so...
+  add_property(OMXPLAYER_DBUS_INTERFACE_ROOT, {"Fullscreen", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 1); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_ROOT, {"HasTrackList", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 0); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_ROOT, {"Identity", "s",
+    [](OMXControl *c, DBusMessageIter *iter) { append_string(iter, "OMXPlayer"); }, NULL});
+  //TODO: Update ?
+  add_property(OMXPLAYER_DBUS_INTERFACE_ROOT, {"SupportedUriSchemes", "as",
+    [](OMXControl *c, DBusMessageIter *iter)
     {
-      if (strcmp(property, "CanRaise")==0)
-      {
-        dbus_respond_boolean(m, 0);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "CanQuit")==0)
-      {
-        dbus_respond_boolean(m, 1);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "CanSetFullscreen")==0)
-      {
-        dbus_respond_boolean(m, 0);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "Fullscreen")==0) //Fullscreen is read/write in theory not read only, but read only at the moment so...
-      {
-        dbus_respond_boolean(m, 1);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "HasTrackList")==0)
-      {
-        dbus_respond_boolean(m, 0);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "Identity")==0)
-      {
-        dbus_respond_string(m, "OMXPlayer");
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "SupportedUriSchemes")==0) //TODO: Update ?
-      {
-        const char *UriSchemes[] = {"file", "http", "rtsp", "rtmp"};
-        dbus_respond_array(m, UriSchemes, 4); // Array is of length 4
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "SupportedMimeTypes")==0) //Vinc: TODO: Minimal list of supported types based on ffmpeg minimal support ?
-      {
-        const char *MimeTypes[] = {}; // Needs supplying
-        dbus_respond_array(m, MimeTypes, 0);
-        return KeyConfig::ACTION_BLANK;
-      }
-      //Wrong property
-      else
-      {
-        //Error
-        CLog::Log(LOGWARNING, "Unhandled dbus property message, member: %s interface: %s type: %d path: %s property: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m), property );
-        dbus_respond_error(m, DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property");
-        return KeyConfig::ACTION_BLANK;
-      }
-    }
-    //Player interface:
-    else if (strcmp(interface, OMXPLAYER_DBUS_INTERFACE_PLAYER)==0)
+      const char *UriSchemes[] = {"file", "http", "rtsp", "rtmp"};
+      append_array(iter, UriSchemes, 4); // Array is of length 4
+    }, NULL});
+  //Vinc: TODO: Minimal list of supported types based on ffmpeg minimal support ?
+  add_property(OMXPLAYER_DBUS_INTERFACE_ROOT, {"SupportedMimeTypes", "as",
+    [](OMXControl *c, DBusMessageIter *iter) { append_array(iter, NULL, 0); }, NULL}); // Needs supplying
+
+  //---------------------------DBus player interface----------------------------
+  //MPRIS2 properties:
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"CanGoNext", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 0); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"CanGoPrevious", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 0); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"CanSeek", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, c->reader->CanSeek()); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"CanControl", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 1); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"CanPlay", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 1); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"CanPause", "b",
+    [](OMXControl *c, DBusMessageIter *iter) { append_boolean(iter, 1); }, NULL});
+  // Returns the current position in microseconds
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"Position", "x",
+    [](OMXControl *c, DBusMessageIter *iter) { append_int64(iter, c->clock->OMXMediaTime()); }, NULL});
+  // What the user asked for, the clock also stops while buffering
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"PlaybackStatus", "s",
+    [](OMXControl *c, DBusMessageIter *iter) { append_string(iter, c->playback_status); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"MinimumRate", "d",
+    [](OMXControl *c, DBusMessageIter *iter) { append_double(iter, (MIN_RATE)/1000.); }, NULL});
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"MaximumRate", "d",
+    [](OMXControl *c, DBusMessageIter *iter) { append_double(iter, (MAX_RATE)/1000.); }, NULL});
+  //return current playing rate
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"Rate", "d",
+    [](OMXControl *c, DBusMessageIter *iter) { append_double(iter, (double)c->clock->OMXPlaySpeed()/1000.); },
+    [](OMXControl *c, DBusMessage *m, double rate) -> OMXControlResult
     {
-      //MPRIS2 properties:
-      if (strcmp(property, "CanGoNext")==0)
-      {
-        dbus_respond_boolean(m, 0);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "CanGoPrevious")==0)
-      {
-        dbus_respond_boolean(m, 0);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "CanSeek")==0)
-      {
-        dbus_respond_boolean(m, reader->CanSeek());
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "CanControl")==0)
-      {
-        dbus_respond_boolean(m, 1);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "CanPlay")==0)
+      if(rate>MAX_RATE/1000.)
       {
-        dbus_respond_boolean(m, 1);
-        return KeyConfig::ACTION_BLANK;
+        rate=MAX_RATE/1000.;
       }
-      else if (strcmp(property, "CanPause")==0)
+      if(rate<MIN_RATE/1000.)
       {
-        dbus_respond_boolean(m, 1);
-        return KeyConfig::ACTION_BLANK;
+        //Set to Pause according to MPRIS2 specs (no actual change of playing rate)
+        c->dbus_respond_double(m, (double)c->clock->OMXPlaySpeed()/1000.);
+        return KeyConfig::ACTION_PAUSE;
       }
-      else if (strcmp(property, "Position")==0)
+      int iSpeed=(int)(rate*1000.);
+      if(!c->clock)
       {
-        // Returns the current position in microseconds
-        int64_t pos = clock->OMXMediaTime();
-        dbus_respond_int64(m, pos);
+        c->dbus_respond_double(m, .0);//What value ????
         return KeyConfig::ACTION_BLANK;
       }
-      else if (strcmp(property, "PlaybackStatus")==0)
-      {
-        const char *status;
-        if (clock->OMXIsPaused())
-        {
-          status = "Paused";
-        }
-        else
-        {
-          status = "Playing";
-        }
-        dbus_respond_string(m, status);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "MinimumRate")==0)
-      {
-        dbus_respond_double(m, (MIN_RATE)/1000.);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "MaximumRate")==0)
-      {
-        dbus_respond_double(m, (MAX_RATE)/1000.);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "Rate")==0)
-      {
-        //return current playing rate
-        dbus_respond_double(m, (double)clock->OMXPlaySpeed()/1000.);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "Volume")==0)
-      {
-        //return current volume
-        dbus_respond_double(m, audio->GetVolume());
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "Metadata")==0)
-      {
-        DBusMessage *reply;
-        reply = dbus_message_new_method_return(m);
-        if(reply)
-        {
-          //Create iterator: Array of dict entries, composed of string (key)) and variant (value)
-          DBusMessageIter array_cont, dict_cont, dict_entry_cont, var;
-          dbus_message_iter_init_append(reply, &array_cont);
-          dbus_message_iter_open_container(&array_cont, DBUS_TYPE_ARRAY, "{sv}", &dict_cont);
-            //First dict entry: URI
-            const char *key1 = "xesam:url";
-            char uri[PATH_MAX+7];
-            ToURI(reader->getFilename(), uri);
-            const char *value1=uri;
-            dbus_message_iter_open_container(&dict_cont, DBUS_TYPE_DICT_ENTRY, NULL, &dict_entry_cont);
-              dbus_message_iter_append_basic(&dict_entry_cont, DBUS_TYPE_STRING, &key1);
-              dbus_message_iter_open_container(&dict_entry_cont, DBUS_TYPE_VARIANT, DBUS_TYPE_STRING_AS_STRING, &var);
-              dbus_message_iter_append_basic(&var, DBUS_TYPE_STRING, &value1);
-              dbus_message_iter_close_container(&dict_entry_cont, &var);
-            dbus_message_iter_close_container(&dict_cont, &dict_entry_cont);
-            //Second dict entry: duration in us
-            const char *key2 = "mpris:length";
-            dbus_int64_t value2 = reader->GetStreamLength()*1000;
-            reader->GetStreamLength();
-            dbus_message_iter_open_container(&dict_cont, DBUS_TYPE_DICT_ENTRY, NULL, &dict_entry_cont);
-              dbus_message_iter_append_basic(&dict_entry_cont, DBUS_TYPE_STRING, &key2);
-              dbus_message_iter_open_container(&dict_entry_cont, DBUS_TYPE_VARIANT, DBUS_TYPE_INT64_AS_STRING, &var);
-              dbus_message_iter_append_basic(&var, DBUS_TYPE_INT64, &value2);
-              dbus_message_iter_close_container(&dict_entry_cont, &var);
-            dbus_message_iter_close_container(&dict_cont, &dict_entry_cont);
-          dbus_message_iter_close_container(&array_cont, &dict_cont);
-          //Send message
-          dbus_connection_send(bus, reply, NULL);
-          dbus_message_unref(reply);
-        }
-        return KeyConfig::ACTION_BLANK;
-      }
-
-      //Non-MPRIS2 properties:
-      else if (strcmp(property, "Aspect")==0)
-      {
-        // Returns aspect ratio
-        double ratio = reader->GetAspectRatio();
-        dbus_respond_double(m, ratio);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "VideoStreamCount")==0)
-      {
-        // Returns number of video streams
-        int64_t vcount = reader->VideoStreamCount();
-        dbus_respond_int64(m, vcount);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "ResWidth")==0)
-      {
-        // Returns width of video
-        int64_t width = reader->GetWidth();
-        dbus_respond_int64(m, width);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "ResHeight")==0)
-      {
-        // Returns height of video
-        int64_t height = reader->GetHeight();
-        dbus_respond_int64(m, height);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property,  "Duration")==0)
-      {
-        // Returns the duration in microseconds
-        int64_t dur = reader->GetStreamLength();
-        dur *= 1000; // ms -> us
-        dbus_respond_int64(m, dur);
-        return KeyConfig::ACTION_BLANK;
-      }
-      //Wrong property
-      else
-      {
-        //Error
-        CLog::Log(LOGWARNING, "Unhandled dbus property message, member: %s interface: %s type: %d path: %s  property: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m), property );
-        dbus_respond_error(m, DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property");
-        return KeyConfig::ACTION_BLANK;
-      }
-    }
-    //Wrong interface:
-    else
-    {
-        //Error
-        CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
-        dbus_respond_error(m, DBUS_ERROR_UNKNOWN_INTERFACE, "Unknown interface");
-        return KeyConfig::ACTION_BLANK;
-    }
-  }
-  //Properties Set method:
-  //TODO: implement signal generation on some property changes
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Set"))
-  {
-    DBusError error;
-    dbus_error_init(&error);
-
-    //Retrieve interface, property name and value
-    //Message has the form message[STRING:interface STRING:property DOUBLE:value] or message[STRING:interface STRING:property VARIANT[DOUBLE:value]]
-    const char *interface, *property;
-    double new_property_value;
-    DBusMessageIter args;
-    dbus_message_iter_init(m, &args);
-    if(dbus_message_iter_has_next(&args))
+      //Can't do trickplay here so limit max speed
+      if(iSpeed > MAX_RATE)
+        iSpeed=MAX_RATE;
+      c->dbus_respond_double(m, iSpeed/1000.);//Reply before applying to be faster
+      c->clock->OMXSetSpeed(iSpeed, false, true);
+      return KeyConfig::ACTION_PLAY;
+    }});
+  //return current volume
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"Volume", "d",
+    [](OMXControl *c, DBusMessageIter *iter) { append_double(iter, c->audio->GetVolume()); },
+    [](OMXControl *c, DBusMessage *m, double volume) -> OMXControlResult
     {
-		//The interface name
-		if( DBUS_TYPE_STRING == dbus_message_iter_get_arg_type(&args) ) 
-			dbus_message_iter_get_basic (&args, &interface);
-		else
-		{
-			printf("setE1\n");
-			CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
-			dbus_error_free(&error);
-			dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
-			return KeyConfig::ACTION_BLANK;
-		}
-		//The property name
-		if( dbus_message_iter_next(&args) && DBUS_TYPE_STRING == dbus_message_iter_get_arg_type(&args) )
-			dbus_message_iter_get_basic (&args, &property);
-		else
-		{
-			CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
-			dbus_error_free(&error);
-			dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
-			return KeyConfig::ACTION_BLANK;
-		}
-		//The value (either double or double in variant)
-		if (dbus_message_iter_next(&args))
-		{
-			//Simply a double
-			if (DBUS_TYPE_DOUBLE == dbus_message_iter_get_arg_type(&args))
-			{
-				dbus_message_iter_get_basic(&args, &new_property_value);
-			}
-			//A double within a variant
-			else if(DBUS_TYPE_VARIANT == dbus_message_iter_get_arg_type(&args))
-			{
-				DBusMessageIter variant;
-				dbus_message_iter_recurse(&args, &variant);
-				if(DBUS_TYPE_DOUBLE == dbus_message_iter_get_arg_type(&variant))
-				{
-					dbus_message_iter_get_basic(&variant, &new_property_value);
-				}
-			}
-			else
-			{
-				CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
-				dbus_error_free(&error);
-				dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
-				return KeyConfig::ACTION_BLANK;
-			}
-		}
-	}
-    if ( dbus_error_is_set(&error) )
-    {
-        CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
-        dbus_error_free(&error);
-        dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
-        return KeyConfig::ACTION_BLANK;
-    }
-    //Player interface:
-    if (strcmp(interface, OMXPLAYER_DBUS_INTERFACE_PLAYER)==0)
-    {
-      if (strcmp(property, "Volume")==0)
-      {
-        double volume=new_property_value;
-        //Min value is 0
-        if(volume<.0)
-        {
-          volume=.0;
-        }
-        audio->SetVolume(volume);
-        dbus_respond_double(m, volume);
-        return KeyConfig::ACTION_BLANK;
-      }
-      else if (strcmp(property, "Rate")==0)
-      {
-        double rate=new_property_value;
-        if(rate>MAX_RATE/1000.)
-        {
-          rate=MAX_RATE/1000.;
-        }
-        if(rate<MIN_RATE/1000.)
-        {
-          //Set to Pause according to MPRIS2 specs (no actual change of playing rate)
-          dbus_respond_double(m, (double)clock->OMXPlaySpeed()/1000.);
-          return KeyConfig::ACTION_PAUSE;
-        }
-        int iSpeed=(int)(rate*1000.);
-        if(!clock)
-        {
-          dbus_respond_double(m, .0);//What value ????
-          return KeyConfig::ACTION_BLANK;
-        }
-        //Can't do trickplay here so limit max speed
-        if(iSpeed > MAX_RATE)
-          iSpeed=MAX_RATE;
-        dbus_respond_double(m, iSpeed/1000.);//Reply before applying to be faster
-        clock->OMXSetSpeed(iSpeed, false, true);
-        return KeyConfig::ACTION_PLAY;
-      }
-      //Wrong property
-      else
+      //Min value is 0
+      if(volume<.0)
       {
-        //Error
-        CLog::Log(LOGWARNING, "Unhandled dbus property message, member: %s interface: %s type: %d path: %s  property: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m), property );
-        dbus_respond_error(m, DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property");
-        return KeyConfig::ACTION_BLANK;
+        volume=.0;
       }
-    }
-    //Wrong interface:
-    else
+      c->audio->SetVolume(volume);
+      c->dbus_respond_double(m, volume);
+      return KeyConfig::ACTION_BLANK;
+    }});
+  //Array of dict entries, composed of string (key)) and variant (value)
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"Metadata", "a{sv}",
+    [](OMXControl *c, DBusMessageIter *iter)
     {
-        //Error
-        CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
-        dbus_respond_error(m, DBUS_ERROR_UNKNOWN_INTERFACE, "Unknown interface");
-        return KeyConfig::ACTION_BLANK;
-    }
-  }
+      DBusMessageIter dict_cont, dict_entry_cont, var;
+      dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "{sv}", &dict_cont);
+        //First dict entry: URI
+        const char *key1 = "xesam:url";
+        char uri[PATH_MAX+7];
+        ToURI(c->reader->getFilename(), uri);
+        const char *value1=uri;
+        dbus_message_iter_open_container(&dict_cont, DBUS_TYPE_DICT_ENTRY, NULL, &dict_entry_cont);
+          dbus_message_iter_append_basic(&dict_entry_cont, DBUS_TYPE_STRING, &key1);
+          dbus_message_iter_open_container(&dict_entry_cont, DBUS_TYPE_VARIANT, DBUS_TYPE_STRING_AS_STRING, &var);
+          dbus_message_iter_append_basic(&var, DBUS_TYPE_STRING, &value1);
+          dbus_message_iter_close_container(&dict_entry_cont, &var);
+        dbus_message_iter_close_container(&dict_cont, &dict_entry_cont);
+        //Second dict entry: duration in us
+        const char *key2 = "mpris:length";
+        dbus_int64_t value2 = c->reader->GetStreamLength()*1000;
+        dbus_message_iter_open_container(&dict_cont, DBUS_TYPE_DICT_ENTRY, NULL, &dict_entry_cont);
+          dbus_message_iter_append_basic(&dict_entry_cont, DBUS_TYPE_STRING, &key2);
+          dbus_message_iter_open_container(&dict_entry_cont, DBUS_TYPE_VARIANT, DBUS_TYPE_INT64_AS_STRING, &var);
+          dbus_message_iter_append_basic(&var, DBUS_TYPE_INT64, &value2);
+          dbus_message_iter_close_container(&dict_entry_cont, &var);
+        dbus_message_iter_close_container(&dict_cont, &dict_entry_cont);
+      dbus_message_iter_close_container(iter, &dict_cont);
+    }, NULL});
+
+  //Non-MPRIS2 properties:
+  // Returns aspect ratio
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"Aspect", "d",
+    [](OMXControl *c, DBusMessageIter *iter) { append_double(iter, c->reader->GetAspectRatio()); }, NULL});
+  // Returns number of video streams
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"VideoStreamCount", "x",
+    [](OMXControl *c, DBusMessageIter *iter) { append_int64(iter, c->reader->VideoStreamCount()); }, NULL});
+  // Returns width of video
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"ResWidth", "x",
+    [](OMXControl *c, DBusMessageIter *iter) { append_int64(iter, c->reader->GetWidth()); }, NULL});
+  // Returns height of video
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"ResHeight", "x",
+    [](OMXControl *c, DBusMessageIter *iter) { append_int64(iter, c->reader->GetHeight()); }, NULL});
+  // Returns the duration in microseconds
+  add_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, {"Duration", "x",
+    [](OMXControl *c, DBusMessageIter *iter)
+    {
+      int64_t dur = c->reader->GetStreamLength();
+      dur *= 1000; // ms -> us
+      append_int64(iter, dur);
+    }, NULL});
+
+  //Properties methods:
+  add_method(DBUS_INTERFACE_PROPERTIES, "Get", [](OMXControl *c, DBusMessage *m)
+  {
+    return c->properties_get(m);
+  });
+  add_method(DBUS_INTERFACE_PROPERTIES, "GetAll", [](OMXControl *c, DBusMessage *m)
+  {
+    return c->properties_get_all(m);
+  });
+  add_method(DBUS_INTERFACE_PROPERTIES, "Set", [](OMXControl *c, DBusMessage *m)
+  {
+    return c->properties_set(m);
+  });
   //----------------------------------------------------------------------------
 
 
   //-------------------------DEPRECATED PROPERTIES METHODS----------------------
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanQuit")
-      || dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Fullscreen"))
-  {
-    dbus_respond_boolean(m, 1);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanSetFullscreen")
-      || dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanRaise")
-      || dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "HasTrackList"))
+  // These answer like the property of the same name
+  for (const char *name : {"CanQuit", "Fullscreen", "CanSetFullscreen", "CanRaise",
+                           "HasTrackList", "Identity", "SupportedMimeTypes",
+                           "CanGoNext", "CanGoPrevious", "CanSeek", "CanControl",
+                           "CanPlay", "CanPause", "PlaybackStatus", "Position",
+                           "Aspect", "VideoStreamCount", "ResWidth", "ResHeight",
+                           "Duration"})
   {
-    dbus_respond_boolean(m, 0);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Identity"))
-  {
-    dbus_respond_string(m, "OMXPlayer");
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
+    add_method(DBUS_INTERFACE_PROPERTIES, name, [](OMXControl *c, DBusMessage *m)
+    {
+      return c->deprecated_get(m);
+    });
   }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "SupportedUriSchemes"))
+  add_method(DBUS_INTERFACE_PROPERTIES, "SupportedUriSchemes", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     const char *UriSchemes[] = {"file", "http", "rtsp", "rtmp"};
-    dbus_respond_array(m, UriSchemes, 2); // Array is of length 2
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "SupportedMimeTypes"))
-  {
-    const char *MimeTypes[] = {}; // Needs supplying
-    dbus_respond_array(m, MimeTypes, 0);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanGoNext")
-        || dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanGoPrevious"))
-  {
-    dbus_respond_boolean(m, 0);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanSeek"))
-  {
-    dbus_respond_boolean(m, reader->CanSeek());
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanControl")
-        || dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanPlay")
-        || dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "CanPause"))
-  {
-    dbus_respond_boolean(m, 1);
+    c->dbus_respond_array(m, UriSchemes, 2); // Array is of length 2
     deprecatedMessage();
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "PlaybackStatus"))
+  });
+  add_method(DBUS_INTERFACE_PROPERTIES, "GetSource", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    const char *status;
-    if (clock->OMXIsPaused())
-    {
-      status = "Paused";
-    }
-    else
-    {
-      status = "Playing";
-    }
-
-    dbus_respond_string(m, status);
+    c->dbus_respond_string(m, c->reader->getFilename().c_str());
     deprecatedMessage();
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "GetSource"))
-  {
-    dbus_respond_string(m, reader->getFilename().c_str());
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Volume"))
+  });
+  add_method(DBUS_INTERFACE_PROPERTIES, "Volume", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -676,7 +506,7 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     if (dbus_error_is_set(&error))
     { // i.e. Get current volume
       dbus_error_free(&error);
-      dbus_respond_double(m, audio->GetVolume());
+      c->dbus_respond_double(m, c->audio->GetVolume());
       deprecatedMessage();
       return KeyConfig::ACTION_BLANK;
     }
@@ -687,128 +517,79 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
       {
         volume=.0;
       }
-      audio->SetVolume(volume);
-      dbus_respond_double(m, volume);
+      c->audio->SetVolume(volume);
+      c->dbus_respond_double(m, volume);
       deprecatedMessage();
       return KeyConfig::ACTION_BLANK;
     }
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Mute"))
+  });
+  add_method(DBUS_INTERFACE_PROPERTIES, "Mute", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    audio->SetMute(true);
-    dbus_respond_ok(m);
+    c->audio->SetMute(true);
+    c->dbus_respond_ok(m);
     deprecatedMessage();
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Unmute"))
+  });
+  add_method(DBUS_INTERFACE_PROPERTIES, "Unmute", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    audio->SetMute(false);
-    dbus_respond_ok(m);
+    c->audio->SetMute(false);
+    c->dbus_respond_ok(m);
     deprecatedMessage();
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Position"))
+  });
+  add_method(DBUS_INTERFACE_PROPERTIES, "MinimumRate", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    // Returns the current position in microseconds
-    int64_t pos = clock->OMXMediaTime();
-    dbus_respond_int64(m, pos);
+    c->dbus_respond_double(m, 0.0);
     deprecatedMessage();
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Aspect"))
-  {
-    // Returns aspect ratio
-    double ratio = reader->GetAspectRatio();
-    dbus_respond_double(m, ratio);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "VideoStreamCount"))
-  {
-    // Returns number of video streams
-    int64_t vcount = reader->VideoStreamCount();
-    dbus_respond_int64(m, vcount);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "ResWidth"))
-  {
-    // Returns width of video
-    int64_t width = reader->GetWidth();
-    dbus_respond_int64(m, width);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "ResHeight"))
-  {
-    // Returns height of video
-    int64_t height = reader->GetHeight();
-    dbus_respond_int64(m, height);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "Duration"))
-  {
-    // Returns the duration in microseconds
-    int64_t dur = reader->GetStreamLength();
-    dur *= 1000; // ms -> us
-    dbus_respond_int64(m, dur);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "MinimumRate"))
-  {
-    dbus_respond_double(m, 0.0);
-    deprecatedMessage();
-    return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, DBUS_INTERFACE_PROPERTIES, "MaximumRate"))
+  });
+  add_method(DBUS_INTERFACE_PROPERTIES, "MaximumRate", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     //TODO: to be made consistent
-    dbus_respond_double(m, 10.125);
+    c->dbus_respond_double(m, 10.125);
     deprecatedMessage();
     return KeyConfig::ACTION_BLANK;
-  }
+  });
   //----------------------------------------------------------------------------
 
 
   //--------------------------Player interface methods--------------------------
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "GetSource"))
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "GetSource", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_string(m, reader->getFilename().c_str());
+    c->dbus_respond_string(m, c->reader->getFilename().c_str());
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Next"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Next", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_NEXT_CHAPTER;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Previous"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Previous", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_PREVIOUS_CHAPTER;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Pause"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Pause", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_PAUSE;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Play"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Play", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_PLAY;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "PlayPause"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "PlayPause", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_PLAYPAUSE;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Stop"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Stop", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_EXIT;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Seek"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Seek", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -821,16 +602,16 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     {
        CLog::Log(LOGWARNING, "Seek D-Bus Error: %s", error.message );
        dbus_error_free(&error);
-       dbus_respond_ok(m);
+       c->dbus_respond_ok(m);
        return KeyConfig::ACTION_BLANK;
     }
     else
     {
-       dbus_respond_int64(m, offset);
+       c->dbus_respond_int64(m, offset);
        return OMXControlResult(KeyConfig::ACTION_SEEK_RELATIVE, offset);
     }
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "SetPosition"))
+  }, always_seeks);
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "SetPosition", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -844,16 +625,16 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     {
       CLog::Log(LOGWARNING, "SetPosition D-Bus Error: %s", error.message );
       dbus_error_free(&error);
-      dbus_respond_ok(m);
+      c->dbus_respond_ok(m);
       return KeyConfig::ACTION_BLANK;
     }
     else
     {
-      dbus_respond_int64(m, position);
+      c->dbus_respond_int64(m, position);
       return OMXControlResult(KeyConfig::ACTION_SEEK_ABSOLUTE, position);
     }
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "SetAlpha"))
+  }, always_seeks);
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "SetAlpha", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -867,16 +648,16 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     {
       CLog::Log(LOGWARNING, "SetAlpha D-Bus Error: %s", error.message );
       dbus_error_free(&error);
-      dbus_respond_ok(m);
+      c->dbus_respond_ok(m);
       return KeyConfig::ACTION_BLANK;
     }
     else
     {
-      dbus_respond_int64(m, alpha);
+      c->dbus_respond_int64(m, alpha);
       return OMXControlResult(KeyConfig::ACTION_SET_ALPHA, alpha);
     }
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "SetLayer"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "SetLayer", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -889,16 +670,16 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     {
       CLog::Log(LOGWARNING, "SetLayer D-Bus Error: %s", error.message );
       dbus_error_free(&error);
-      dbus_respond_ok(m);
+      c->dbus_respond_ok(m);
       return KeyConfig::ACTION_BLANK;
     }
     else
     {
-      dbus_respond_int64(m, layer);
+      c->dbus_respond_int64(m, layer);
       return OMXControlResult(KeyConfig::ACTION_SET_LAYER, layer);
     }
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "SetAspectMode"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "SetAspectMode", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -912,110 +693,56 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     {
       CLog::Log(LOGWARNING, "SetAspectMode D-Bus Error: %s", error.message );
       dbus_error_free(&error);
-      dbus_respond_ok(m);
+      c->dbus_respond_ok(m);
       return KeyConfig::ACTION_BLANK;
     }
     else
     {
-      dbus_respond_string(m, aspectMode);
+      c->dbus_respond_string(m, aspectMode);
       return OMXControlResult(KeyConfig::ACTION_SET_ASPECT_MODE, aspectMode);
     }
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Mute"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Mute", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    audio->SetMute(true);
-    dbus_respond_ok(m);
+    c->audio->SetMute(true);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Unmute"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Unmute", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    audio->SetMute(false);
-    dbus_respond_ok(m);
+    c->audio->SetMute(false);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "ListSubtitles"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "ListSubtitles", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    int count = reader->SubtitleStreamCount();
-    char** values = new char*[count];
-
-    for (int i=0; i < count; i++)
-    {
-       asprintf(&values[i], "%d:%s:%s:%s:%s", i,
-                                              reader->GetStreamLanguage(OMXSTREAM_SUBTITLE, i).c_str(),
-                                              reader->GetStreamName(OMXSTREAM_SUBTITLE, i).c_str(),
-                                              reader->GetCodecName(OMXSTREAM_SUBTITLE, i).c_str(),
-                                              ((int)subtitles->GetActiveStream() == i) ? "active" : "");
-    }
-
-    dbus_respond_array(m, (const char**)values, count);
-
-    // Cleanup
-    for (int i=0; i < count; i++)
-    {
-      delete[] values[i];
-    }
-
+    c->dbus_respond_streams(m, OMXSTREAM_SUBTITLE, c->reader->SubtitleStreamCount(),
+                            (int)c->subtitles->GetActiveStream());
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "HideVideo"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "HideVideo", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_HIDE_VIDEO;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "UnHideVideo"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "UnHideVideo", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    dbus_respond_ok(m);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_UNHIDE_VIDEO;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "ListAudio"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "ListAudio", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    int count = reader->AudioStreamCount();
-    char** values = new char*[count];
-
-    for (int i=0; i < count; i++)
-    {
-       asprintf(&values[i], "%d:%s:%s:%s:%s", i,
-                                              reader->GetStreamLanguage(OMXSTREAM_AUDIO, i).c_str(),
-                                              reader->GetStreamName(OMXSTREAM_AUDIO, i).c_str(),
-                                              reader->GetCodecName(OMXSTREAM_AUDIO, i).c_str(),
-                                              (reader->GetAudioIndex() == i) ? "active" : "");
-    }
-
-    dbus_respond_array(m, (const char**)values, count);
-
-    // Cleanup
-    for (int i=0; i < count; i++)
-    {
-      delete[] values[i];
-    }
-
+    c->dbus_respond_streams(m, OMXSTREAM_AUDIO, c->reader->AudioStreamCount(),
+                            c->reader->GetAudioIndex());
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "ListVideo"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "ListVideo", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    int count = reader->VideoStreamCount();
-    char** values = new char*[count];
-
-    for (int i=0; i < count; i++)
-    {
-       asprintf(&values[i], "%d:%s:%s:%s:%s", i,
-                                              reader->GetStreamLanguage(OMXSTREAM_VIDEO, i).c_str(),
-                                              reader->GetStreamName(OMXSTREAM_VIDEO, i).c_str(),
-                                              reader->GetCodecName(OMXSTREAM_VIDEO, i).c_str(),
-                                              (reader->GetVideoIndex() == i) ? "active" : "");
-    }
-
-    dbus_respond_array(m, (const char**)values, count);
-
-    // Cleanup
-    for (int i=0; i < count; i++)
-    {
-      delete[] values[i];
-    }
-
+    c->dbus_respond_streams(m, OMXSTREAM_VIDEO, c->reader->VideoStreamCount(),
+                            c->reader->GetVideoIndex());
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "SelectSubtitle"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "SelectSubtitle", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -1026,22 +753,22 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     if (dbus_error_is_set(&error))
     {
       dbus_error_free(&error);
-      dbus_respond_boolean(m, 0);
+      c->dbus_respond_boolean(m, 0);
     }
     else
     {
-      if (reader->SetActiveStream(OMXSTREAM_SUBTITLE, index))
+      if (c->reader->SetActiveStream(OMXSTREAM_SUBTITLE, index))
       {
-        subtitles->SetActiveStream(reader->GetSubtitleIndex());
-        dbus_respond_boolean(m, 1);
+        c->subtitles->SetActiveStream(c->reader->GetSubtitleIndex());
+        c->dbus_respond_boolean(m, 1);
       }
       else {
-        dbus_respond_boolean(m, 0);
+        c->dbus_respond_boolean(m, 0);
       }
     }
     return KeyConfig::ACTION_BLANK;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "SelectAudio"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "SelectAudio", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -1052,34 +779,34 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     if (dbus_error_is_set(&error))
     {
       dbus_error_free(&error);
-      dbus_respond_boolean(m, 0);
+      c->dbus_respond_boolean(m, 0);
     }
     else
     {
-      if (reader->SetActiveStream(OMXSTREAM_AUDIO, index))
+      if (c->reader->SetActiveStream(OMXSTREAM_AUDIO, index))
       {
-        dbus_respond_boolean(m, 1);
+        c->dbus_respond_boolean(m, 1);
       }
       else {
-        dbus_respond_boolean(m, 0);
+        c->dbus_respond_boolean(m, 0);
       }
     }
     return KeyConfig::ACTION_BLANK;
-  }
+  });
   // TODO: SelectVideo ???
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "ShowSubtitles"))
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "ShowSubtitles", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    subtitles->SetVisible(true);
-    dbus_respond_ok(m);
+    c->subtitles->SetVisible(true);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_SHOW_SUBTITLES;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "HideSubtitles"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "HideSubtitles", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
-    subtitles->SetVisible(false);
-    dbus_respond_ok(m);
+    c->subtitles->SetVisible(false);
+    c->dbus_respond_ok(m);
     return KeyConfig::ACTION_HIDE_SUBTITLES;
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "OpenUri"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "OpenUri", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -1091,16 +818,16 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     {
       CLog::Log(LOGWARNING, "Change file D-Bus Error: %s", error.message );
       dbus_error_free(&error);
-      dbus_respond_ok(m);
+      c->dbus_respond_ok(m);
       return KeyConfig::ACTION_BLANK;
     }
     else
     {
-      dbus_respond_string(m, file);
+      c->dbus_respond_string(m, file);
       return OMXControlResult(KeyConfig::ACTION_CHANGE_FILE, file);
     }
-  }
-  else if (dbus_message_is_method_call(m, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Action"))
+  });
+  add_method(OMXPLAYER_DBUS_INTERFACE_PLAYER, "Action", [](OMXControl *c, DBusMessage *m) -> OMXControlResult
   {
     DBusError error;
     dbus_error_init(&error);
@@ -1111,22 +838,356 @@ OMXControlResult OMXControl::handle_event(DBusMessage *m)
     if (dbus_error_is_set(&error))
     {
       dbus_error_free(&error);
-      dbus_respond_ok(m);
+      c->dbus_respond_ok(m);
       return KeyConfig::ACTION_BLANK;
     }
     else
     {
-      dbus_respond_ok(m);
+      c->dbus_respond_ok(m);
       return action; // Directly return enum
     }
-  }
+  }, action_seeks);
   //----------------------------------------------------------------------------
-  else {
+}
+
+const std::string &OMXControl::make_key(const char *interface, const char *member)
+{
+  lookup_key.assign(interface);
+  lookup_key += '\n';
+  lookup_key += member;
+  return lookup_key;
+}
+
+void OMXControl::add_method(const char *interface, const char *member, MethodHandler handler, MethodSeeks seeks)
+{
+  methods[make_key(interface, member)] = {handler, seeks};
+}
+
+void OMXControl::add_property(const char *interface, const Property &property)
+{
+  properties[make_key(interface, property.name)] = property;
+  interface_properties[interface].push_back(property);
+}
+
+const OMXControl::Method *OMXControl::find_method(DBusMessage *m)
+{
+  const char *interface = dbus_message_get_interface(m);
+  const char *member = dbus_message_get_member(m);
+
+  if (dbus_message_get_type(m) != DBUS_MESSAGE_TYPE_METHOD_CALL || !interface || !member)
+    return NULL;
+
+  auto it = methods.find(make_key(interface, member));
+  return it != methods.end() ? &it->second : NULL;
+}
+
+const OMXControl::Property *OMXControl::find_property(const char *interface, const char *name)
+{
+  auto it = properties.find(make_key(interface, name));
+  return it != properties.end() ? &it->second : NULL;
+}
+
+void OMXControl::append_property_entry(DBusMessageIter *dict, const Property &property)
+{
+  DBusMessageIter dict_entry_cont, var;
+  dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, NULL, &dict_entry_cont);
+    dbus_message_iter_append_basic(&dict_entry_cont, DBUS_TYPE_STRING, &property.name);
+    dbus_message_iter_open_container(&dict_entry_cont, DBUS_TYPE_VARIANT, property.signature, &var);
+    property.get(this, &var);
+    dbus_message_iter_close_container(&dict_entry_cont, &var);
+  dbus_message_iter_close_container(dict, &dict_entry_cont);
+}
+
+void OMXControl::signal_properties_changed(const char *interface, const char *names[], int count)
+{
+  DBusMessage *signal = dbus_message_new_signal(OMXPLAYER_DBUS_PATH_SERVER, DBUS_INTERFACE_PROPERTIES, "PropertiesChanged");
+  if (!signal)
+  {
+    CLog::Log(LOGWARNING, "Failed to allocate message");
+    return;
+  }
+
+  //Interface, changed properties with their values and invalidated properties
+  DBusMessageIter args, dict_cont, array_cont;
+  dbus_message_iter_init_append(signal, &args);
+  dbus_message_iter_append_basic(&args, DBUS_TYPE_STRING, &interface);
+  dbus_message_iter_open_container(&args, DBUS_TYPE_ARRAY, "{sv}", &dict_cont);
+  for (int i = 0; i < count; i++)
+    append_property_entry(&dict_cont, *find_property(interface, names[i]));
+  dbus_message_iter_close_container(&args, &dict_cont);
+  dbus_message_iter_open_container(&args, DBUS_TYPE_ARRAY, DBUS_TYPE_STRING_AS_STRING, &array_cont);
+  dbus_message_iter_close_container(&args, &array_cont);
+
+  dbus_connection_send(bus, signal, NULL);
+  dbus_message_unref(signal);
+}
+
+void OMXControl::update(bool paused)
+{
+  if (!bus)
+    return;
+
+  const char *changed[4];
+  int count = 0;
+
+  const char *status = paused ? "Paused" : "Playing";
+  if (status != playback_status)
+  {
+    playback_status = status;
+    changed[count++] = "PlaybackStatus";
+  }
+  double current_volume = audio->GetVolume();
+  if (current_volume != volume)
+  {
+    volume = current_volume;
+    changed[count++] = "Volume";
+  }
+  if (metadata_changed)
+  {
+    metadata_changed = false;
+    changed[count++] = "Metadata";
+  }
+  // Only on request, MPRIS clients are expected to work the position out
+  if (position_interval > 0 && !paused)
+  {
+    auto now = std::chrono::steady_clock::now();
+    if (now - position_sent >= std::chrono::milliseconds(position_interval))
+    {
+      position_sent = now;
+      changed[count++] = "Position";
+    }
+  }
+
+  if (count)
+    signal_properties_changed(OMXPLAYER_DBUS_INTERFACE_PLAYER, changed, count);
+}
+
+void OMXControl::seeked(int64_t position)
+{
+  if (!bus)
+    return;
+
+  DBusMessage *signal = dbus_message_new_signal(OMXPLAYER_DBUS_PATH_SERVER, OMXPLAYER_DBUS_INTERFACE_PLAYER, "Seeked");
+  if (!signal)
+  {
+    CLog::Log(LOGWARNING, "Failed to allocate message");
+    return;
+  }
+
+  dbus_int64_t pos = position;
+  dbus_message_append_args(signal, DBUS_TYPE_INT64, &pos, DBUS_TYPE_INVALID);
+  dbus_connection_send(bus, signal, NULL);
+  dbus_message_unref(signal);
+}
+
+void OMXControl::trackChanged()
+{
+  metadata_changed = true;
+}
+
+void OMXControl::stopped()
+{
+  if (!bus)
+    return;
+
+  const char *changed[] = {"PlaybackStatus"};
+  playback_status = "Stopped";
+  signal_properties_changed(OMXPLAYER_DBUS_INTERFACE_PLAYER, changed, 1);
+  dbus_connection_flush(bus);
+}
+
+void OMXControl::setPositionInterval(int ms)
+{
+  position_interval = ms;
+}
+
+OMXControlResult OMXControl::handle_event(DBusMessage *m)
+{
+  const Method *method = find_method(m);
+  if (method)
+    return method->handle(this, m);
+
+  CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+  if (dbus_message_get_type(m) == DBUS_MESSAGE_TYPE_METHOD_CALL)
+    dbus_respond_error(m, DBUS_ERROR_UNKNOWN_METHOD, "Unknown method");
+
+  return KeyConfig::ACTION_BLANK;
+}
+
+OMXControlResult OMXControl::properties_get(DBusMessage *m)
+{
+  DBusError error;
+  dbus_error_init(&error);
+
+  //Retrieve interface and property name
+  const char *interface, *property;
+  if (!dbus_message_get_args(m, &error, DBUS_TYPE_STRING, &interface, DBUS_TYPE_STRING, &property, DBUS_TYPE_INVALID))
+  {
+    CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+    dbus_error_free(&error);
+    dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
+    return KeyConfig::ACTION_BLANK;
+  }
+
+  //Wrong interface:
+  if (interface_properties.find(interface) == interface_properties.end())
+  {
     CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
-    if (dbus_message_get_type(m) == DBUS_MESSAGE_TYPE_METHOD_CALL)
-      dbus_respond_error(m, DBUS_ERROR_UNKNOWN_METHOD, "Unknown method");
+    dbus_respond_error(m, DBUS_ERROR_UNKNOWN_INTERFACE, "Unknown interface");
+    return KeyConfig::ACTION_BLANK;
+  }
+
+  //Wrong property
+  const Property *found = find_property(interface, property);
+  if (!found)
+  {
+    CLog::Log(LOGWARNING, "Unhandled dbus property message, member: %s interface: %s type: %d path: %s property: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m), property );
+    dbus_respond_error(m, DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property");
+    return KeyConfig::ACTION_BLANK;
   }
 
+  dbus_respond_property(m, *found);
+  return KeyConfig::ACTION_BLANK;
+}
+
+OMXControlResult OMXControl::properties_get_all(DBusMessage *m)
+{
+  DBusError error;
+  dbus_error_init(&error);
+
+  const char *interface;
+  if (!dbus_message_get_args(m, &error, DBUS_TYPE_STRING, &interface, DBUS_TYPE_INVALID))
+  {
+    CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+    dbus_error_free(&error);
+    dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
+    return KeyConfig::ACTION_BLANK;
+  }
+
+  auto it = interface_properties.find(interface);
+  if (it == interface_properties.end())
+  {
+    CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+    dbus_respond_error(m, DBUS_ERROR_UNKNOWN_INTERFACE, "Unknown interface");
+    return KeyConfig::ACTION_BLANK;
+  }
+
+  DBusMessage *reply = dbus_message_new_method_return(m);
+  if (!reply)
+  {
+    CLog::Log(LOGWARNING, "Failed to allocate message");
+    return KeyConfig::ACTION_BLANK;
+  }
+
+  //Array of dict entries, composed of property name and value in a variant
+  DBusMessageIter array_cont, dict_cont;
+  dbus_message_iter_init_append(reply, &array_cont);
+  dbus_message_iter_open_container(&array_cont, DBUS_TYPE_ARRAY, "{sv}", &dict_cont);
+  for (const Property &property : it->second)
+    append_property_entry(&dict_cont, property);
+  dbus_message_iter_close_container(&array_cont, &dict_cont);
+
+  dbus_connection_send(bus, reply, NULL);
+  dbus_message_unref(reply);
+
+  return KeyConfig::ACTION_BLANK;
+}
+
+OMXControlResult OMXControl::properties_set(DBusMessage *m)
+{
+  DBusError error;
+  dbus_error_init(&error);
+
+  //Retrieve interface, property name and value
+  //Message has the form message[STRING:interface STRING:property DOUBLE:value] or message[STRING:interface STRING:property VARIANT[DOUBLE:value]]
+  const char *interface = NULL, *property = NULL;
+  double new_property_value = 0;
+  DBusMessageIter args;
+  dbus_message_iter_init(m, &args);
+  if(dbus_message_iter_has_next(&args))
+  {
+	//The interface name
+	if( DBUS_TYPE_STRING == dbus_message_iter_get_arg_type(&args) ) 
+		dbus_message_iter_get_basic (&args, &interface);
+	else
+	{
+		CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+		dbus_error_free(&error);
+		dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
+		return KeyConfig::ACTION_BLANK;
+	}
+	//The property name
+	if( dbus_message_iter_next(&args) && DBUS_TYPE_STRING == dbus_message_iter_get_arg_type(&args) )
+		dbus_message_iter_get_basic (&args, &property);
+	else
+	{
+		CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+		dbus_error_free(&error);
+		dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
+		return KeyConfig::ACTION_BLANK;
+	}
+	//The value (either double or double in variant)
+	if (dbus_message_iter_next(&args))
+	{
+		//Simply a double
+		if (DBUS_TYPE_DOUBLE == dbus_message_iter_get_arg_type(&args))
+		{
+			dbus_message_iter_get_basic(&args, &new_property_value);
+		}
+		//A double within a variant
+		else if(DBUS_TYPE_VARIANT == dbus_message_iter_get_arg_type(&args))
+		{
+			DBusMessageIter variant;
+			dbus_message_iter_recurse(&args, &variant);
+			if(DBUS_TYPE_DOUBLE == dbus_message_iter_get_arg_type(&variant))
+			{
+				dbus_message_iter_get_basic(&variant, &new_property_value);
+			}
+		}
+		else
+		{
+			CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+			dbus_error_free(&error);
+			dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
+			return KeyConfig::ACTION_BLANK;
+		}
+	}
+  }
+  if ( dbus_error_is_set(&error) || !interface || !property )
+  {
+      CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+      dbus_error_free(&error);
+      dbus_respond_error(m, DBUS_ERROR_INVALID_ARGS, "Invalid arguments");
+      return KeyConfig::ACTION_BLANK;
+  }
+  //Wrong interface:
+  if (interface_properties.find(interface) == interface_properties.end())
+  {
+      CLog::Log(LOGWARNING, "Unhandled dbus message, member: %s interface: %s type: %d path: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m) );
+      dbus_respond_error(m, DBUS_ERROR_UNKNOWN_INTERFACE, "Unknown interface");
+      return KeyConfig::ACTION_BLANK;
+  }
+  //Wrong or read only property
+  const Property *found = find_property(interface, property);
+  if (!found || !found->set)
+  {
+    CLog::Log(LOGWARNING, "Unhandled dbus property message, member: %s interface: %s type: %d path: %s  property: %s", dbus_message_get_member(m), dbus_message_get_interface(m), dbus_message_get_type(m), dbus_message_get_path(m), property );
+    dbus_respond_error(m, DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property");
+    return KeyConfig::ACTION_BLANK;
+  }
+
+  return found->set(this, m, new_property_value);
+}
+
+OMXControlResult OMXControl::deprecated_get(DBusMessage *m)
+{
+  const char *name = dbus_message_get_member(m);
+  const Property *found = find_property(OMXPLAYER_DBUS_INTERFACE_PLAYER, name);
+  if (!found)
+    found = find_property(OMXPLAYER_DBUS_INTERFACE_ROOT, name);
+
+  dbus_respond_property(m, *found);
+  deprecatedMessage();
   return KeyConfig::ACTION_BLANK;
 }
 
@@ -1254,3 +1315,49 @@ DBusHandlerResult OMXControl::dbus_respond_array(DBusMessage *m, const char *arr
 
   return DBUS_HANDLER_RESULT_HANDLED;
 }
+
+DBusHandlerResult OMXControl::dbus_respond_property(DBusMessage *m, const Property &property)
+{
+  DBusMessage *reply;
+
+  reply = dbus_message_new_method_return(m);
+
+  if (!reply)
+  {
+    CLog::Log(LOGWARNING, "Failed to allocate message");
+    return DBUS_HANDLER_RESULT_NEED_MEMORY;
+  }
+
+  DBusMessageIter iter;
+  dbus_message_iter_init_append(reply, &iter);
+  property.get(this, &iter);
+  dbus_connection_send(bus, reply, NULL);
+  dbus_message_unref(reply);
+
+  return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+DBusHandlerResult OMXControl::dbus_respond_streams(DBusMessage *m, OMXStreamType type, int count, int active)
+{
+  char** values = new char*[count];
+
+  for (int i=0; i < count; i++)
+  {
+     asprintf(&values[i], "%d:%s:%s:%s:%s", i,
+                                            reader->GetStreamLanguage(type, i).c_str(),
+                                            reader->GetStreamName(type, i).c_str(),
+                                            reader->GetCodecName(type, i).c_str(),
+                                            (active == i) ? "active" : "");
+  }
+
+  DBusHandlerResult result = dbus_respond_array(m, (const char**)values, count);
+
+  // Cleanup
+  for (int i=0; i < count; i++)
+  {
+    free(values[i]);
+  }
+  delete[] values;
+
+  return result;
+}
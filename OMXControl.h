@@ -3,6 +3,11 @@
 #define OMXPLAYER_DBUS_INTERFACE_PLAYER "org.mpris.MediaPlayer2.Player"
 
 #include <dbus/dbus.h>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "OMXClock.h"
 #include "OMXPlayerAudio.h"
 #include "OMXPlayerSubtitles.h"
@@ -40,10 +45,69 @@ public:
   int init(OMXClock *m_av_clock, OMXPlayerAudio *m_player_audio, OMXPlayerSubtitles *m_player_subtitles, OMXReader *m_omx_reader, std::string& dbus_name);
   OMXControlResult getEvent();
   void dispatch();
+  int getFd();
+  bool pending();
+  // Whether a call waiting to be handled moves the playback position. Reads
+  // what has arrived, property reads and other calls don't count.
+  bool seekPending();
+  // Signals property changes, call once per main loop iteration
+  void update(bool paused);
+  void seeked(int64_t position);
+  void trackChanged();
+  void stopped();
+  void setPositionInterval(int ms);
 private:
+  typedef OMXControlResult (*MethodHandler)(OMXControl *control, DBusMessage *m);
+  typedef bool (*MethodSeeks)(DBusMessage *m);
+  typedef void (*PropertyGetter)(OMXControl *control, DBusMessageIter *iter);
+  typedef OMXControlResult (*PropertySetter)(OMXControl *control, DBusMessage *m, double value);
+
+  struct Method
+  {
+    MethodHandler handle;
+    MethodSeeks   seeks;  // NULL when the call never seeks
+  };
+
+  struct Property
+  {
+    const char     *name;
+    const char     *signature;
+    PropertyGetter  get;
+    PropertySetter  set;
+  };
+
+  // Handlers are looked up by interface and member, properties by
+  // interface and name
+  std::unordered_map<std::string, Method> methods;
+  std::unordered_map<std::string, Property> properties;
+  std::unordered_map<std::string, std::vector<Property>> interface_properties;
+  std::string lookup_key;
+  // Taken off the connection by seekPending, handled before the rest
+  std::deque<DBusMessage *> queued;
+
+  // Last signalled state, so that only changes are sent
+  const char *playback_status;
+  double      volume;
+  bool        metadata_changed;
+  int         position_interval;
+  std::chrono::steady_clock::time_point position_sent;
+
+  void register_handlers();
+  void add_method(const char *interface, const char *member, MethodHandler handler, MethodSeeks seeks = NULL);
+  void add_property(const char *interface, const Property &property);
+  const std::string &make_key(const char *interface, const char *member);
+  const Method *find_method(DBusMessage *m);
+  const Property *find_property(const char *interface, const char *name);
+  void append_property_entry(DBusMessageIter *dict, const Property &property);
+  void signal_properties_changed(const char *interface, const char *names[], int count);
+
   int dbus_connect(std::string& dbus_name);
   void dbus_disconnect();
   OMXControlResult handle_event(DBusMessage *m);
+  OMXControlResult properties_get(DBusMessage *m);
+  OMXControlResult properties_get_all(DBusMessage *m);
+  OMXControlResult properties_set(DBusMessage *m);
+  OMXControlResult deprecated_get(DBusMessage *m);
   DBusHandlerResult dbus_respond_error(DBusMessage *m, const char *name, const char *msg);
   DBusHandlerResult dbus_respond_ok(DBusMessage *m);
   DBusHandlerResult dbus_respond_int64(DBusMessage *m, int64_t i);
@@ -51,4 +115,6 @@ private:
   DBusHandlerResult dbus_respond_boolean(DBusMessage *m, int b);
   DBusHandlerResult dbus_respond_string(DBusMessage *m, const char *text);
   DBusHandlerResult dbus_respond_array(DBusMessage *m, const char *array[], int size);
+  DBusHandlerResult dbus_respond_property(DBusMessage *m, const Property &property);
+  DBusHandlerResult dbus_respond_streams(DBusMessage *m, OMXStreamType type, int count, int active);
 };
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "OMXEventLoop.h"
+#include "OMXClock.h"
+#include "utils/log.h"
+
+OMXEventLoop::OMXEventLoop()
+{
+  m_epoll_fd    = -1;
+  m_wake_fd     = -1;
+  m_timer_fd    = -1;
+  m_interval_ms = 0;
+  m_open_time   = 0;
+  m_timer_time  = 0;
+  m_waits       = 0;
+  memset(m_wakeups, 0, sizeof(m_wakeups));
+  m_idle_wakeups = 0;
+}
+
+OMXEventLoop::~OMXEventLoop()
+{
+  Close();
+}
+
+bool OMXEventLoop::Open()
+{
+  struct epoll_event ev;
+
+  Close();
+
+  m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  m_wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (m_epoll_fd < 0 || m_wake_fd < 0 || m_timer_fd < 0)
+  {
+    CLog::Log(LOGERROR, "OMXEventLoop::Open - %s", strerror(errno));
+    Close();
+    return false;
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = EVENT_WAKE;
+  epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &ev);
+  ev.data.u32 = EVENT_TIMER;
+  epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_timer_fd, &ev);
+
+  m_open_time = OMXClock::GetAbsoluteClock();
+  return true;
+}
+
+void OMXEventLoop::Close()
+{
+  if (m_epoll_fd >= 0)
+    LogStats();
+
+  if (m_timer_fd >= 0)
+    close(m_timer_fd);
+  if (m_wake_fd >= 0)
+    close(m_wake_fd);
+  if (m_epoll_fd >= 0)
+    close(m_epoll_fd);
+  m_epoll_fd = m_wake_fd = m_timer_fd = -1;
+  m_interval_ms = 0;
+  m_waits = m_idle_wakeups = 0;
+  memset(m_wakeups, 0, sizeof(m_wakeups));
+}
+
+bool OMXEventLoop::AddControlFd(int fd)
+{
+  struct epoll_event ev;
+
+  if (m_epoll_fd < 0 || fd < 0)
+    return false;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = EVENT_CONTROL;
+  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+  {
+    CLog::Log(LOGERROR, "OMXEventLoop::AddControlFd(%d) - %s", fd, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void OMXEventLoop::SetTimer(unsigned int interval_ms)
+{
+  struct itimerspec its;
+
+  if (interval_ms == m_interval_ms)
+    return;
+
+  m_interval_ms = interval_ms;
+  if (m_timer_fd < 0)
+    return;
+
+  its.it_interval.tv_sec  = interval_ms / 1000;
+  its.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+  its.it_value = its.it_interval;
+  timerfd_settime(m_timer_fd, 0, &its, NULL);
+}
+
+void OMXEventLoop::Wake()
+{
+  uint64_t one = 1;
+
+  if (m_wake_fd >= 0 && write(m_wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    CLog::Log(LOGERROR, "OMXEventLoop::Wake - %s", strerror(errno));
+}
+
+unsigned int OMXEventLoop::Wait(int timeout_ms)
+{
+  struct epoll_event ev[4];
+  unsigned int events = 0;
+  uint64_t count;
+  int n;
+
+  // Without epoll fall back to polling control and pacing the timer by hand
+  if (m_epoll_fd < 0)
+  {
+    int64_t now;
+    if (timeout_ms)
+      OMXClock::OMXSleep(timeout_ms < 0 ? 10 : timeout_ms);
+    now = OMXClock::GetAbsoluteClock();
+    if (now - m_timer_time < (int64_t)m_interval_ms * 1000)
+      return EVENT_CONTROL;
+    m_timer_time = now;
+    return EVENT_CONTROL | EVENT_TIMER;
+  }
+
+  // A signal returns early so that g_abort is seen promptly
+  n = epoll_wait(m_epoll_fd, ev, sizeof(ev) / sizeof(ev[0]), timeout_ms);
+
+  for (int i = 0; i < n; i++)
+    events |= ev[i].data.u32;
+
+  // Both fds only count events; reading them rearms the level trigger
+  if (events & EVENT_WAKE)
+    while (read(m_wake_fd, &count, sizeof(count)) > 0);
+  if (events & EVENT_TIMER)
+    while (read(m_timer_fd, &count, sizeof(count)) > 0);
+
+  if (timeout_ms != 0)
+  {
+    m_waits++;
+    for (int i = 0; i < 3; i++)
+      if (events & (1 << i))
+        m_wakeups[i]++;
+    if (!(events & (EVENT_CONTROL | EVENT_WAKE)))
+      m_idle_wakeups++;
+  }
+  return events;
+}
+
+void OMXEventLoop::LogStats()
+{
+  double elapsed = (OMXClock::GetAbsoluteClock() - m_open_time) * 1e-6;
+
+  CLog::Log(LOGINFO, "OMXEventLoop: %u waits in %.1fs (%.1f/s): control %u wake %u timer %u, idle %u (%.1f/s)",
+    m_waits, elapsed, elapsed > 0.0 ? m_waits / elapsed : 0.0,
+    m_wakeups[0], m_wakeups[1], m_wakeups[2],
+    m_idle_wakeups, elapsed > 0.0 ? m_idle_wakeups / elapsed : 0.0);
+}
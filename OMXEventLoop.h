@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+// Blocks the main loop until something needs its attention: a control fd
+// (DBus) becomes readable, another thread calls Wake() (queue space freed,
+// key pressed) or the periodic buffering timer expires.
+class OMXEventLoop
+{
+public:
+  enum
+  {
+    EVENT_CONTROL = 1 << 0,
+    EVENT_WAKE    = 1 << 1,
+    EVENT_TIMER   = 1 << 2,
+  };
+
+  OMXEventLoop();
+  ~OMXEventLoop();
+  bool Open();
+  void Close();
+  bool AddControlFd(int fd);
+  void SetTimer(unsigned int interval_ms);
+  void Wake();
+  // Returns a mask of EVENT_*, 0 on timeout. timeout_ms < 0 waits forever.
+  unsigned int Wait(int timeout_ms);
+  void LogStats();
+
+private:
+  int m_epoll_fd;
+  int m_wake_fd;
+  int m_timer_fd;
+  unsigned int m_interval_ms;
+  int64_t m_open_time;
+  int64_t m_timer_time;
+  unsigned int m_waits;
+  unsigned int m_wakeups[3];
+  unsigned int m_idle_wakeups;
+};
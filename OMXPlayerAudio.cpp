@@ -34,9 +34,11 @@ OMXPlayerAudio::OMXPlayerAudio()
   m_av_clock      = NULL;
   m_omx_reader    = NULL;
   m_decoder       = NULL;
-  m_flush         = false;
-  m_flush_requested = false;
+  m_generation    = 0;
+  m_decoder_generation = 0;
   m_cached_size   = 0;
+  m_space_wanted  = false;
+  m_event_loop    = NULL;
   m_pAudioCodec   = NULL;
   m_player_error  = true;
   m_CurrentVolume = 0.0f;
@@ -45,6 +47,7 @@ OMXPlayerAudio::OMXPlayerAudio()
 
   pthread_cond_init(&m_packet_cond, NULL);
   pthread_cond_init(&m_audio_cond, NULL);
+  pthread_cond_init(&m_flushed_cond, NULL);
   pthread_mutex_init(&m_lock, NULL);
   pthread_mutex_init(&m_lock_decoder, NULL);
 }
@@ -54,6 +57,7 @@ OMXPlayerAudio::~OMXPlayerAudio()
   Close();
 
   pthread_cond_destroy(&m_audio_cond);
+  pthread_cond_destroy(&m_flushed_cond);
   pthread_cond_destroy(&m_packet_cond);
   pthread_mutex_destroy(&m_lock);
   pthread_mutex_destroy(&m_lock_decoder);
@@ -100,8 +104,6 @@ bool OMXPlayerAudio::Open(OMXClock *av_clock, const OMXAudioConfig &config, OMXR
   m_hw_decode   = false;
   m_iCurrentPts = AV_NOPTS_VALUE;
   m_bAbort      = false;
-  m_flush       = false;
-  m_flush_requested = false;
   m_cached_size = 0;
   m_pAudioCodec = NULL;
 
@@ -141,6 +143,7 @@ bool OMXPlayerAudio::Close()
 
     StopThread();
   }
+  ReleaseStale();
 
   CloseDecoder();
   CloseAudioCodec();
@@ -242,7 +245,7 @@ bool OMXPlayerAudio::Decode(OMXPacket *pkt)
       while((int) m_decoder->GetSpace() < decoded_size)
       {
         OMXClock::OMXSleep(10);
-        if(m_flush_requested) return true;
+        if(pkt->generation != m_generation) return true;
       }
 
       int ret = 0;
@@ -259,7 +262,7 @@ bool OMXPlayerAudio::Decode(OMXPacket *pkt)
     while((int) m_decoder->GetSpace() < pkt->size)
     {
       OMXClock::OMXSleep(10);
-      if(m_flush_requested) return true;
+      if(pkt->generation != m_generation) return true;
     }
 
     m_decoder->AddPackets(pkt->data, pkt->size, pkt->dts, pkt->pts, 0);
@@ -271,31 +274,34 @@ bool OMXPlayerAudio::Decode(OMXPacket *pkt)
 void OMXPlayerAudio::Process()
 {
   OMXPacket *omx_pkt = NULL;
+  std::vector<std::deque<OMXPacket *>> stale;
 
   while(true)
   {
     Lock();
-    if(!(m_bStop || m_bAbort) && m_packets.empty())
+    if(!(m_bStop || m_bAbort) && m_packets.empty() && m_stale.empty() &&
+       m_decoder_generation == m_generation)
       pthread_cond_wait(&m_packet_cond, &m_lock);
 
     if (m_bStop || m_bAbort)
     {
       UnLock();
+      pthread_cond_broadcast(&m_flushed_cond);
       break;
     }
 
-    if(m_flush && omx_pkt)
-    {
-      delete omx_pkt;
-      omx_pkt = NULL;
-      m_flush = false;
-    }
-    else if(!omx_pkt && !m_packets.empty())
+    stale.swap(m_stale);
+    if(!omx_pkt && !m_packets.empty())
     {
       omx_pkt = m_packets.front();
       if (omx_pkt)
       {
         m_cached_size -= omx_pkt->size;
+        if(m_space_wanted && m_event_loop)
+        {
+          m_space_wanted = false;
+          m_event_loop->Wake();
+        }
       }
       else
       {
@@ -305,13 +311,19 @@ void OMXPlayerAudio::Process()
       m_packets.pop_front();
     }
     UnLock();
-    
+
+    for(std::deque<OMXPacket *> &packets : stale)
+      for(OMXPacket *pkt : packets)
+        delete pkt;
+    stale.clear();
+
     LockDecoder();
-    if(m_flush && omx_pkt)
+    if(m_decoder_generation != m_generation)
+      FlushDecoder();
+    if(omx_pkt && omx_pkt->generation != m_generation)
     {
       delete omx_pkt;
       omx_pkt = NULL;
-      m_flush = false;
     }
     else if(omx_pkt && Decode(omx_pkt))
     {
@@ -325,29 +337,81 @@ void OMXPlayerAudio::Process()
     delete omx_pkt;
 }
 
+// Only swaps the queue out, so it never waits on a Decode in progress
 void OMXPlayerAudio::Flush()
 {
-  m_flush_requested = true;
   Lock();
-  LockDecoder();
-  if(m_pAudioCodec)
-    m_pAudioCodec->Reset();
-  m_flush_requested = false;
-  m_flush = true;
-  while (!m_packets.empty())
-  {
-    OMXPacket *pkt = m_packets.front(); 
-    m_packets.pop_front();
-    delete pkt;
-  }
+  m_generation++;
+  m_stale.emplace_back();
+  m_stale.back().swap(m_packets);
   m_iCurrentPts = AV_NOPTS_VALUE;
   m_cached_size = 0;
+  UnLock();
+  pthread_cond_broadcast(&m_packet_cond);
+}
+
+// Called by the decode thread with the decoder locked
+void OMXPlayerAudio::FlushDecoder()
+{
+  unsigned int generation = m_generation;
+  if(m_pAudioCodec)
+    m_pAudioCodec->Reset();
   if(m_decoder)
     m_decoder->Flush();
-  UnLockDecoder();
+  Lock();
+  // Decode may have set it from a pre-flush packet after Flush cleared it
+  m_iCurrentPts = AV_NOPTS_VALUE;
+  m_decoder_generation = generation;
+  UnLock();
+  pthread_cond_broadcast(&m_flushed_cond);
+}
+
+void OMXPlayerAudio::WaitFlushed()
+{
+  Lock();
+  while(m_decoder_generation != m_generation && Running() && !(m_bStop || m_bAbort))
+    pthread_cond_wait(&m_flushed_cond, &m_lock);
   UnLock();
 }
 
+// Frees what Flush left behind once the decode thread is gone
+void OMXPlayerAudio::ReleaseStale()
+{
+  for(std::deque<OMXPacket *> &packets : m_stale)
+    for(OMXPacket *pkt : packets)
+      delete pkt;
+  m_stale.clear();
+}
+
+bool OMXPlayerAudio::SkipTo(int64_t pts, bool drop_all)
+{
+  Lock();
+
+  std::deque<OMXPacket *>::iterator it;
+  for (it = m_packets.begin(); it != m_packets.end() && *it; ++it)
+    if ((*it)->pts != AV_NOPTS_VALUE && (*it)->pts >= pts)
+      break;
+
+  bool found = drop_all || (it != m_packets.end() && *it);
+  if (found)
+  {
+    m_generation++;
+    m_stale.emplace_back(m_packets.begin(), it);
+    for (OMXPacket *pkt : m_stale.back())
+      m_cached_size -= pkt->size;
+    m_packets.erase(m_packets.begin(), it);
+    for (OMXPacket *pkt : m_packets)
+      if (pkt)
+        pkt->generation = m_generation;
+    m_iCurrentPts = AV_NOPTS_VALUE;
+  }
+
+  UnLock();
+  if (found)
+    pthread_cond_broadcast(&m_packet_cond);
+  return found;
+}
+
 bool OMXPlayerAudio::AddPacket(OMXPacket *pkt)
 {
   bool ret = false;
@@ -358,15 +422,20 @@ bool OMXPlayerAudio::AddPacket(OMXPacket *pkt)
   if(m_bStop || m_bAbort)
     return ret;
 
+  Lock();
   if((m_cached_size + pkt->size) < m_config.queue_size * 1024 * 1024)
   {
-    Lock();
+    pkt->generation = m_generation;
     m_cached_size += pkt->size;
     m_packets.push_back(pkt);
-    UnLock();
     ret = true;
-    pthread_cond_broadcast(&m_packet_cond);
   }
+  else
+    m_space_wanted = true;
+  UnLock();
+
+  if(ret)
+    pthread_cond_broadcast(&m_packet_cond);
 
   return ret;
 }
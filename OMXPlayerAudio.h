@@ -34,8 +34,10 @@
 #include "OMXAudio.h"
 #include "OMXAudioCodecOMX.h"
 #include "OMXThread.h"
+#include "OMXEventLoop.h"
 
 #include <deque>
+#include <vector>
 #include <string>
 #include <atomic>
 #include <sys/types.h>
@@ -56,6 +58,7 @@ protected:
   int64_t                   m_iCurrentPts;
   pthread_cond_t            m_packet_cond;
   pthread_cond_t            m_audio_cond;
+  pthread_cond_t            m_flushed_cond;
   pthread_mutex_t           m_lock_decoder;
   OMXClock                  *m_av_clock;
   OMXReader                 *m_omx_reader;
@@ -66,9 +69,16 @@ protected:
   bool                      m_hw_decode;
   bool                      m_boost_on_downmix;
   bool                      m_bAbort;
-  bool                      m_flush;
-  std::atomic<bool>         m_flush_requested;
+  // Flush bumps the generation and hands the queue to m_stale. The decode
+  // thread drops packets of older generations, frees m_stale and resets the
+  // decoder once m_decoder_generation falls behind, then signals
+  // m_flushed_cond.
+  std::atomic<unsigned int> m_generation;
+  unsigned int              m_decoder_generation;
+  std::vector<std::deque<OMXPacket *>> m_stale;
   unsigned int              m_cached_size;
+  bool                      m_space_wanted;
+  OMXEventLoop              *m_event_loop;
   OMXAudioConfig            m_config;
   COMXAudioCodecOMX         *m_pAudioCodec;
   float                     m_CurrentVolume;
@@ -80,6 +90,8 @@ protected:
   void UnLock();
   void LockDecoder();
   void UnLockDecoder();
+  void FlushDecoder();
+  void ReleaseStale();
 private:
 public:
   OMXPlayerAudio();
@@ -89,7 +101,15 @@ public:
   bool Decode(OMXPacket *pkt);
   void Process() override;
   void Flush();
+  // Waits for the decode thread to reset the decoder after Flush or SkipTo,
+  // so that the delay and cache figures no longer count flushed data
+  void WaitFlushed();
+  // Drops queued packets before pts. Unless drop_all, only does so when a
+  // packet at or after pts is queued.
+  bool SkipTo(int64_t pts, bool drop_all);
   bool AddPacket(OMXPacket *pkt);
+  // Woken once a rejected AddPacket would fit again
+  void SetEventLoop(OMXEventLoop *event_loop) { m_event_loop = event_loop; }
   bool OpenAudioCodec();
   void CloseAudioCodec();      
   bool IsPassthrough(COMXStreamInfo hints);
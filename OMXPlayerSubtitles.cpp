@@ -18,9 +18,11 @@
 
 #include "OMXPlayerSubtitles.h"
 #include "SubtitleRenderer.h"
+#include "SubtitlePrerenderer.h"
+#include "SubtitleIndex.h"
 #include "Subtitle.h"
-#include "DllAvCodec.h"
 #include "utils/Enforce.h"
+#include "utils/LockBlock.h"
 #include "utils/ScopeExit.h"
 #include "utils/log.h"
 
@@ -43,7 +45,10 @@ OMXPlayerSubtitles::OMXPlayerSubtitles() BOOST_NOEXCEPT
   m_centered(),
   m_ghost_box(),
   m_lines(),
-  m_av_clock()
+  m_av_clock(),
+  m_demux_packets(),
+  m_demux_time(),
+  m_demux_time_max()
 {}
 
 OMXPlayerSubtitles::~OMXPlayerSubtitles() BOOST_NOEXCEPT
@@ -81,11 +86,13 @@ bool OMXPlayerSubtitles::Init(int display,
 
 
 bool OMXPlayerSubtitles::Open(size_t stream_count,
-                              vector<Subtitle>&& external_subtitles) BOOST_NOEXCEPT
+                              std::shared_ptr<SubtitleFileReader> external_subtitles) BOOST_NOEXCEPT
 {
-  m_subtitle_buffers.resize(stream_count, circular_buffer<Subtitle>(32));
+  LOCK_BLOCK(m_buffers_lock)
+    m_subtitle_buffers.resize(stream_count, circular_buffer<Subtitle>(32));
 
-  if(external_subtitles.size() > 0)
+  // The file is read by the render thread, a chunk at a time
+  if(external_subtitles)
   {
     SendToRenderer(Message::SendExternalSubs{std::move(external_subtitles)});
     m_use_external_subtitles = true;
@@ -100,29 +107,39 @@ bool OMXPlayerSubtitles::initDVDSubs(Dimension video,
 {
   SendToRenderer(Message::DVDSubs{video, video_aspect, aspect_mode});
 
-  AVCodec *dvd_codec = m_dllAvCodec.avcodec_find_decoder(AV_CODEC_ID_DVD_SUBTITLE);
-  m_dvd_codec_context = m_dllAvCodec.avcodec_alloc_context3(dvd_codec);
-  m_dllAvCodec.avcodec_open2(m_dvd_codec_context, dvd_codec, NULL);
+  m_dvd_decoder.reset(new SubtitleDecoder([this](size_t stream_index, Subtitle&& sub)
+  {
+    AddSubtitle(stream_index, std::move(sub));
+  }));
 
-  return true;
+  return m_dvd_decoder->Open();
 }
 
 void OMXPlayerSubtitles::Close() BOOST_NOEXCEPT
 {
+  m_dvd_decoder.reset();
   m_mailbox.clear();
-  m_subtitle_buffers.clear();
+  LOCK_BLOCK(m_buffers_lock)
+    m_subtitle_buffers.clear();
+
+  if(m_demux_packets)
+  {
+    CLog::Log(LOGINFO, "OMXPlayerSubtitles: %u packets took %.1fms on the demux thread, %.3fms at most",
+              m_demux_packets, m_demux_time, m_demux_time_max);
+    m_demux_packets = 0;
+    m_demux_time = m_demux_time_max = 0;
+  }
 }
 
 void OMXPlayerSubtitles::DeInit() BOOST_NOEXCEPT
 {
+  m_dvd_decoder.reset();
+
   if(Running())
   {
     SendToRenderer(Message::Stop{});
     StopThread();
   }
-
-  if(m_dvd_codec_context)
-    avcodec_free_context(&m_dvd_codec_context);
 }
 
 void OMXPlayerSubtitles::Process()
@@ -148,13 +165,6 @@ void OMXPlayerSubtitles::Process()
   m_thread_stopped.store(true, memory_order_relaxed);
 }
 
-template <typename Iterator>
-Iterator FindSubtitle(Iterator begin, Iterator end, int time)
-{
-  return upper_bound(begin, end, time,
-    [](int a, const Subtitle& b) { return a < b.stop; });
-}
-
 void OMXPlayerSubtitles::
 RenderLoop(float font_size,
            bool centered,
@@ -168,18 +178,32 @@ RenderLoop(float font_size,
                             ghost_box,
                             lines);
 
+  // Upcoming text subtitles are drawn ahead on a worker
+  SubtitlePrerenderer prerenderer(renderer);
+  const size_t prerender_depth = 3;
+  size_t prerender_index{};
+
+  // Show time error in ms: <5, <10, <20, <50, <100, <200, more
+  static const int error_limits[] = { 5, 10, 20, 50, 100, 200 };
+  unsigned int show_errors[7] = {};
+
   vector<Subtitle> external_subtitles;
   vector<Subtitle> subtitles;
 
+  // Subtitles may overlap, the ones showing are stacked into one image
+  SubtitleIndex index;
+  bool index_stale{};
+  vector<size_t> active;
+
   bool external_subtitles_enabled = false;
+  std::shared_ptr<SubtitleFileReader> external_reader;
+  const size_t external_chunk = 256;
 
   int prev_now{};
   size_t next_index{};
   bool exit{};
   bool paused{};
-  bool have_next{};
-  int current_stop = INT_MIN;
-  bool showing{};
+  bool redraw{};
   bool osd{};
   chrono::time_point<std::chrono::steady_clock> osd_stop;
   int delay{};
@@ -189,38 +213,75 @@ RenderLoop(float font_size,
     return static_cast<int>(clock->OMXMediaTime()/1000) - delay;
   };
 
-  auto TryPrepare = [&](int time)
+  // Newest on top, like stacked ASS events
+  auto StackLines = [&](const vector<size_t>& cues)
   {
-    for(; next_index != subtitles.size(); ++next_index)
+    vector<string> lines;
+    for(auto it = cues.rbegin(); it != cues.rend(); ++it)
     {
-      if(subtitles[next_index].stop > time)
-      {
-        renderer.prepare(subtitles[next_index]);
-        have_next = true;
-        break;
-      }
+      if(!subtitles[*it].isImage)
+        lines.insert(lines.end(), subtitles[*it].text_lines().begin(),
+                                  subtitles[*it].text_lines().end());
     }
+    return lines;
   };
 
-  auto Reset = [&](int time)
+  // Draw what will be showing when each of the next few subtitles starts
+  auto RequestAhead = [&]
   {
-    renderer.unprepare();
-    current_stop = INT_MIN;
+    vector<size_t> cues;
+    prerender_index = max(prerender_index, next_index);
+    for(; prerender_index < subtitles.size() &&
+          prerender_index < next_index + prerender_depth; ++prerender_index)
+    {
+      const Subtitle& sub = subtitles[prerender_index];
+      bool group_end = prerender_index + 1 == subtitles.size() ||
+                       subtitles[prerender_index + 1].start != sub.start;
+      if(sub.isImage || !group_end)
+        continue;
+
+      index.Find(sub.start, cues);
+      auto stacked = StackLines(cues);
+      prerenderer.Request(prerender_index, cues,
+                          Subtitle(sub.start, sub.stop, std::move(stacked)));
+    }
+  };
 
-    auto it = FindSubtitle(subtitles.begin(),
-                           subtitles.end(),
-                           time);
-    next_index = it - subtitles.begin();
+  auto ShowActive = [&]
+  {
+    if(active.empty())
+    {
+      renderer.hide();
+      return;
+    }
 
-    if(next_index != subtitles.size())
+    // A bitmap can't be stacked, the newest one is shown alone
+    const Subtitle& newest = subtitles[active.back()];
+    SubtitleRenderer::Image image;
+    if(newest.isImage)
     {
-      renderer.prepare(subtitles[next_index]);
-      have_next = true;
+      renderer.prepare(subtitles[active.back()]);
+    }
+    else if(prerenderer.Take(active.back(), active, image))
+    {
+      renderer.prepare(image);
     }
     else
     {
-      have_next = false;
+      auto stacked = StackLines(active);
+      renderer.prepare(stacked);
     }
+    renderer.show_next();
+  };
+
+  auto Reset = [&](int time)
+  {
+    prerenderer.Invalidate();
+    prerender_index = 0;
+
+    index.Find(time, active);
+    next_index = index.UpperBound(time);
+    redraw = true;
   };
 
   for(;;)
@@ -231,17 +292,21 @@ RenderLoop(float font_size,
     {
       auto now = GetCurrentTime();
 
-      int till_stop =
-        showing ? current_stop - now
-                : INT_MAX;
+      int till_stop = INT_MAX;
+      for(size_t i : active)
+        till_stop = min(till_stop, subtitles[i].stop - now);
 
       int till_next_start =
-        have_next ? subtitles[next_index].start - now
-                  : INT_MAX;
+        next_index < subtitles.size() ? subtitles[next_index].start - now
+                                      : INT_MAX;
 
-      timeout = min(min(till_stop, till_next_start), 1000);
+      timeout = max(min(min(till_stop, till_next_start), 1000), 0);
     }
 
+    // keep reading the subtitle file between messages
+    if(external_reader)
+      timeout = 0;
+
     if(osd)
     {
       int cap = chrono::duration_cast<std::chrono::milliseconds>(osd_stop - chrono::steady_clock::now()).count();
@@ -259,14 +324,26 @@ RenderLoop(float font_size,
       },
       [&](Message::Push&& args) // Add internal subs from muxer
       {
-        subtitles.push_back(std::move(args.subtitle));
+        if(!subtitles.empty() && args.subtitle.start < subtitles.back().start)
+        {
+          auto it = upper_bound(subtitles.begin(), subtitles.end(), args.subtitle.start,
+            [](int a, const Subtitle& b) { return a < b.start; });
+          subtitles.insert(it, std::move(args.subtitle));
+          index_stale = true;
+        }
+        else
+        {
+          subtitles.push_back(std::move(args.subtitle));
+        }
       },
       [&](Message::SendExternalSubs&& args)
       {
-        external_subtitles = std::move(args.subtitles);
-        subtitles.swap(external_subtitles);
+        external_reader = std::move(args.reader);
+        if(!external_subtitles_enabled)
+          subtitles.swap(external_subtitles);
+        subtitles.clear();
         external_subtitles_enabled = true;
-        prev_now = INT_MAX;
+        index_stale = true;
       },
       [&](Message::ToggleExternalSubs&& args)
       {
@@ -275,12 +352,14 @@ RenderLoop(float font_size,
           subtitles.swap(external_subtitles);
           external_subtitles_enabled = args.enable_subs;
         }
-        prev_now = INT_MAX;
+        index_stale = true;
       },
       [&](Message::Flush&& args) // Sets or clears internal subs
       {
         subtitles = std::move(args.subtitles);
-        prev_now = INT_MAX;
+        stable_sort(subtitles.begin(), subtitles.end(),
+          [](const Subtitle& a, const Subtitle& b) { return a.start < b.start; });
+        index_stale = true;
       },
       [&](Message::Touch&&) // External subs
       {
@@ -302,11 +381,10 @@ RenderLoop(float font_size,
       {
         renderer.prepare(args.text_lines);
         renderer.show_next();
-        showing = true;
         osd = true;
         osd_stop = chrono::steady_clock::now() +
                    chrono::milliseconds(args.duration);
-        prev_now = INT_MAX;
+        redraw = true;
       },
       [&](Message::Clear&&)
       {
@@ -315,15 +393,59 @@ RenderLoop(float font_size,
 
     if(exit) break;
 
+    if(external_reader)
+    {
+      auto& target = external_subtitles_enabled ? subtitles : external_subtitles;
+      if(!external_reader->Read(target, external_chunk))
+      {
+        if(external_reader->Reordered() && external_subtitles_enabled)
+          index_stale = true;
+        external_reader.reset();
+      }
+    }
+
+    if(index_stale)
+    {
+      index.Assign(subtitles);
+      index_stale = false;
+      prev_now = INT_MAX;
+    }
+    else
+    {
+      for(size_t i = index.Size(); i < subtitles.size(); i++)
+        index.Append(subtitles[i]);
+    }
+
     auto now = GetCurrentTime();
 
-    if(now < prev_now || (have_next && subtitles[next_index].stop <= now))
+    if(now < prev_now ||
+       (next_index < subtitles.size() && subtitles[next_index].stop <= now))
     {
       Reset(now);
     }
-    else if(!have_next)
+    else
     {
-      TryPrepare(now);
+      // drop the subtitles that have ended and add the ones that started
+      size_t showing = active.size();
+      active.erase(remove_if(active.begin(), active.end(),
+        [&](size_t i) { return subtitles[i].stop <= now; }), active.end());
+      if(active.size() != showing)
+        redraw = true;
+
+      for(; next_index < subtitles.size() && subtitles[next_index].start <= now; ++next_index)
+      {
+        if(subtitles[next_index].stop <= now)
+          continue;
+
+        int error = now - subtitles[next_index].start;
+        int bucket = 0;
+        while(bucket < 6 && error >= error_limits[bucket])
+          bucket++;
+        show_errors[bucket]++;
+
+        active.push_back(next_index);
+        redraw = true;
+      }
     }
 
     prev_now = now;
@@ -331,27 +453,20 @@ RenderLoop(float font_size,
     if(osd && chrono::steady_clock::now() >= osd_stop)
       osd = false;
 
-    if(!osd && current_stop <= now)
+    if(!osd && redraw)
     {
-      if(have_next && subtitles[next_index].start <= now)
-      {
-        renderer.show_next();
-        // printf("show error: %i ms\n", now - subtitles[next_index].start);
-        showing = true;
-        current_stop = subtitles[next_index].stop;
-
-        ++next_index;
-        have_next = false;
-        TryPrepare(now);
-      }
-      else if(showing)
-      {
-        renderer.hide();
-        // printf("hide error: %i ms\n", now - current_stop);
-        showing = false;
-      }
+      ShowActive();
+      redraw = false;
     }
+
+    RequestAhead();
   }
+
+  CLog::Log(LOGINFO, "OMXPlayerSubtitles: show error <5ms %u, <10ms %u, <20ms %u, <50ms %u, <100ms %u, <200ms %u, more %u",
+            show_errors[0], show_errors[1], show_errors[2], show_errors[3],
+            show_errors[4], show_errors[5], show_errors[6]);
+  CLog::Log(LOGINFO, "OMXPlayerSubtitles: %u of %u text subtitles drawn ahead",
+            prerenderer.GetHits(), prerenderer.GetHits() + prerenderer.GetMisses());
 }
 
 void OMXPlayerSubtitles::FlushRenderer()
@@ -364,18 +479,35 @@ void OMXPlayerSubtitles::FlushRenderer()
   }
   else
   {
+    auto start = chrono::steady_clock::now();
+
+    // Copies only take a reference to each payload
     Message::Flush flush;
-    assert(!m_subtitle_buffers.empty());
-    for(auto& s : m_subtitle_buffers[m_active_index])
-      flush.subtitles.push_back(s);
-    SendToRenderer(std::move(flush));
+    size_t count;
+    LOCK_BLOCK(m_buffers_lock)
+    {
+      assert(!m_subtitle_buffers.empty());
+      auto& buffer = m_subtitle_buffers[m_active_index];
+      flush.subtitles.assign(buffer.begin(), buffer.end());
+      count = buffer.size();
+      SendToRenderer(std::move(flush));
+    }
+
+    CLog::Log(LOGDEBUG, "OMXPlayerSubtitles::FlushRenderer - %zu subtitles in %.3fms", count,
+              chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
   }
 }
 
 void OMXPlayerSubtitles::Flush() BOOST_NOEXCEPT
 {
-  for(auto& q : m_subtitle_buffers)
-    q.clear();
+  if(m_dvd_decoder)
+    m_dvd_decoder->Flush();
+
+  LOCK_BLOCK(m_buffers_lock)
+  {
+    for(auto& q : m_subtitle_buffers)
+      q.clear();
+  }
 
   if(GetVisible())
   {
@@ -400,7 +532,8 @@ void OMXPlayerSubtitles::SetUseExternalSubtitles(bool use) BOOST_NOEXCEPT
 {
   assert(use || !m_subtitle_buffers.empty());
 
-  m_use_external_subtitles = use;
+  LOCK_BLOCK(m_buffers_lock)
+    m_use_external_subtitles = use;
   if(GetVisible())
     FlushRenderer();
 }
@@ -422,7 +555,8 @@ void OMXPlayerSubtitles::SetVisible(bool visible) BOOST_NOEXCEPT
   {
     if (!m_visible)
     {
-      m_visible = true;
+      LOCK_BLOCK(m_buffers_lock)
+        m_visible = true;
       FlushRenderer();
     }
   }
@@ -430,7 +564,8 @@ void OMXPlayerSubtitles::SetVisible(bool visible) BOOST_NOEXCEPT
   {
     if(m_visible)
     {
-      m_visible = false;
+      LOCK_BLOCK(m_buffers_lock)
+        m_visible = false;
 
       if(m_use_external_subtitles)
         SendToRenderer(Message::ToggleExternalSubs{false});
@@ -444,12 +579,13 @@ void OMXPlayerSubtitles::SetActiveStream(size_t index) BOOST_NOEXCEPT
 {
   assert(index < m_subtitle_buffers.size());
 
-  m_active_index = index;
+  LOCK_BLOCK(m_buffers_lock)
+    m_active_index = index;
   if(!GetUseExternalSubtitles() && GetVisible())
     FlushRenderer();
 }
 
-bool OMXPlayerSubtitles::GetTextLines(OMXPacket *pkt, Subtitle &sub)
+bool OMXPlayerSubtitles::GetTextLines(OMXPacket *pkt, vector<string> &text_lines)
 {
   char *start, *end;
   start = (char*)pkt->data;
@@ -479,7 +615,7 @@ bool OMXPlayerSubtitles::GetTextLines(OMXPacket *pkt, Subtitle &sub)
       *p = '\0';
 
       if(*current_line != '\0') // ignore blank lines
-        sub.text_lines.push_back(current_line);
+        text_lines.push_back(current_line);
 
       p += 2;
       current_line = p;
@@ -491,7 +627,7 @@ bool OMXPlayerSubtitles::GetTextLines(OMXPacket *pkt, Subtitle &sub)
 	  if(p > current_line && *(p - 1) == '\r') *(p - 1) = '\0';
 
       if(*current_line != '\0') // ignore blank lines
-        sub.text_lines.push_back(current_line);
+        text_lines.push_back(current_line);
 
       p++;
       current_line = p;
@@ -501,26 +637,27 @@ bool OMXPlayerSubtitles::GetTextLines(OMXPacket *pkt, Subtitle &sub)
   }
 
   if(*current_line != '\0') // ignore blank lines
-    sub.text_lines.push_back(current_line);
+    text_lines.push_back(current_line);
 
-  return !sub.text_lines.empty();
+  return !text_lines.empty();
 }
 
-bool OMXPlayerSubtitles::GetImageData(OMXPacket *pkt, Subtitle &sub)
+void OMXPlayerSubtitles::AddSubtitle(size_t stream_index, Subtitle&& sub)
 {
-  AVSubtitle s;
-  int got_sub_ptr = -1;
-  m_dllAvCodec.avcodec_decode_subtitle2(m_dvd_codec_context, &s, &got_sub_ptr, pkt);
-
-  if(got_sub_ptr < 1 || s.num_rects < 1) return false;
-
-  // Fix time
-  sub.stop = sub.start + (s.end_display_time - s.start_display_time);
-
-  sub.image.data.assign(s.rects[0]->pict.data[0], s.rects[0]->pict.linesize[0] * s.rects[0]->h);
-  sub.image.rect = {s.rects[0]->x, s.rects[0]->y, s.rects[0]->w, s.rects[0]->h};
-
-  return true;
+  LOCK_BLOCK(m_buffers_lock)
+  {
+    assert(stream_index < m_subtitle_buffers.size());
+    auto& buffer = m_subtitle_buffers[stream_index];
+    buffer.push_back(std::move(sub));
+
+    // the buffer and the renderer share the payload
+    if(!m_use_external_subtitles &&
+       m_visible &&
+       stream_index == m_active_index)
+    {
+      SendToRenderer(Message::Push{buffer.back()});
+    }
+  }
 }
 
 bool OMXPlayerSubtitles::AddPacket(OMXPacket *pkt, size_t stream_index) BOOST_NOEXCEPT
@@ -530,47 +667,42 @@ bool OMXPlayerSubtitles::AddPacket(OMXPacket *pkt, size_t stream_index) BOOST_NO
   if(!pkt)
     return false;
 
+  auto begin = chrono::steady_clock::now();
   SCOPE_EXIT
   {
-    delete pkt;
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+    m_demux_packets++;
+    m_demux_time += ms;
+    m_demux_time_max = max(m_demux_time_max, ms);
   };
 
-  if(pkt->hints.codec != AV_CODEC_ID_SUBRIP && 
-     pkt->hints.codec != AV_CODEC_ID_SSA &&
-     pkt->hints.codec != AV_CODEC_ID_ASS &&
-     pkt->hints.codec != AV_CODEC_ID_DVD_SUBTITLE)
+  // Bitmaps are decoded on the decoder's thread, which takes the packet
+  if(pkt->hints.codec == AV_CODEC_ID_DVD_SUBTITLE && m_dvd_decoder)
   {
+    m_dvd_decoder->Add(pkt, stream_index);
     return true;
   }
 
-  Subtitle sub(pkt->hints.codec == AV_CODEC_ID_DVD_SUBTITLE);
-
-  sub.start = static_cast<int>(pkt->pts/1000);
-  sub.stop = sub.start + static_cast<int>(pkt->duration/1000);
+  SCOPE_EXIT
+  {
+    delete pkt;
+  };
 
-  if (!m_subtitle_buffers[stream_index].empty() &&
-    sub.stop < m_subtitle_buffers[stream_index].back().stop)
+  if(pkt->hints.codec != AV_CODEC_ID_SUBRIP && 
+     pkt->hints.codec != AV_CODEC_ID_SSA &&
+     pkt->hints.codec != AV_CODEC_ID_ASS)
   {
-    sub.stop = m_subtitle_buffers[stream_index].back().stop;
+    return true;
   }
 
-  bool success;
-  if(pkt->hints.codec == AV_CODEC_ID_DVD_SUBTITLE)
-    success = GetImageData(pkt, sub);
-  else
-    success = GetTextLines(pkt, sub);
-
-  if(!success) return false;
-
-  m_subtitle_buffers[stream_index].push_back(sub);
+  int start = static_cast<int>(pkt->pts/1000);
+  int duration = static_cast<int>(pkt->duration/1000);
 
-  if(!GetUseExternalSubtitles() &&
-     GetVisible() &&
-     stream_index == GetActiveStream())
-  {
-    SendToRenderer(Message::Push{std::move(sub)});
-  }
+  vector<string> text_lines;
+  if(!GetTextLines(pkt, text_lines))
+    return false;
 
+  AddSubtitle(stream_index, Subtitle(start, start + duration, std::move(text_lines)));
   return true;
 }
 
@@ -22,12 +22,15 @@
 #include "OMXReader.h"
 #include "OMXClock.h"
 #include "Subtitle.h"
+#include "Srt.h"
+#include "SubtitleDecoder.h"
 #include "utils/Mailbox.h"
-#include "DllAvCodec.h"
 
 #include <boost/config.hpp>
 #include <boost/circular_buffer.hpp>
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <utility>
@@ -49,7 +52,7 @@ public:
             OMXClock* clock) BOOST_NOEXCEPT;
 
   bool Open(size_t stream_count,
-            vector<Subtitle>&& external_subtitles) BOOST_NOEXCEPT;
+            std::shared_ptr<SubtitleFileReader> external_subtitles) BOOST_NOEXCEPT;
 
   bool initDVDSubs(Dimension video,
             float video_aspect,
@@ -95,10 +98,6 @@ public:
 
   bool AddPacket(OMXPacket *pkt, size_t stream_index) BOOST_NOEXCEPT;
 
-protected:
-  DllAvCodec                m_dllAvCodec;
-  AVCodecContext           *m_dvd_codec_context;
-
 private:
   struct Message {
     struct DVDSubs
@@ -114,7 +113,7 @@ private:
     };
     struct SendExternalSubs
     {
-      std::vector<Subtitle> subtitles;
+      std::shared_ptr<SubtitleFileReader> reader;
     };
     struct ToggleExternalSubs
     {
@@ -158,11 +157,14 @@ private:
                   bool ghost_box,
                   unsigned int lines,
                   OMXClock* clock);
-  bool GetTextLines(OMXPacket *pkt, Subtitle &sub);
-  bool GetImageData(OMXPacket *pkt, Subtitle &sub);
+  bool GetTextLines(OMXPacket *pkt, std::vector<std::string> &text_lines);
+  void AddSubtitle(size_t stream_index, Subtitle&& sub);
   void FlushRenderer();
 
+  // The buffers are also filled by the DVD subtitle decoder's thread
+  std::mutex                                    m_buffers_lock;
   std::vector<boost::circular_buffer<Subtitle>> m_subtitle_buffers;
+  std::unique_ptr<SubtitleDecoder>              m_dvd_decoder;
   Mailbox<Message::DVDSubs,
           Message::Stop,
           Message::SendExternalSubs,
@@ -186,4 +188,7 @@ private:
   OMXClock*                                     m_av_clock;
   int                                           m_display;
   int                                           m_layer;
+  unsigned int                                  m_demux_packets;
+  double                                        m_demux_time;
+  double                                        m_demux_time_max;
 };
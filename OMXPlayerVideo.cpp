@@ -35,14 +35,17 @@ OMXPlayerVideo::OMXPlayerVideo()
   m_av_clock      = NULL;
   m_decoder       = NULL;
   m_fps           = 25.0f;
-  m_flush         = false;
-  m_flush_requested = false;
+  m_generation    = 0;
+  m_decoder_generation = 0;
   m_cached_size   = 0;
+  m_space_wanted  = false;
+  m_event_loop    = NULL;
   m_iVideoDelay   = 0;
   m_iCurrentPts   = 0;
 
   pthread_cond_init(&m_packet_cond, NULL);
   pthread_cond_init(&m_picture_cond, NULL);
+  pthread_cond_init(&m_flushed_cond, NULL);
   pthread_mutex_init(&m_lock, NULL);
   pthread_mutex_init(&m_lock_decoder, NULL);
 }
@@ -53,6 +56,7 @@ OMXPlayerVideo::~OMXPlayerVideo()
 
   pthread_cond_destroy(&m_packet_cond);
   pthread_cond_destroy(&m_picture_cond);
+  pthread_cond_destroy(&m_flushed_cond);
   pthread_mutex_destroy(&m_lock);
   pthread_mutex_destroy(&m_lock_decoder);
 }
@@ -97,7 +101,6 @@ bool OMXPlayerVideo::Open(OMXClock *av_clock, const OMXVideoConfig &config)
   m_frametime   = 0;
   m_iCurrentPts = AV_NOPTS_VALUE;
   m_bAbort      = false;
-  m_flush       = false;
   m_cached_size = 0;
   m_iVideoDelay = 0;
 
@@ -122,13 +125,12 @@ bool OMXPlayerVideo::Reset()
   // Open calls but does away with the DLL unloading/loading, decoder reset, and
   // thread reset.
   Flush();   
+  WaitFlushed();
   m_stream_id         = -1;
   m_pStream           = NULL;
   m_iCurrentPts       = AV_NOPTS_VALUE;
   m_frametime         = 0;
   m_bAbort            = false;
-  m_flush             = false;
-  m_flush_requested   = false;
   m_cached_size       = 0;
   m_iVideoDelay       = 0;
 
@@ -153,6 +155,7 @@ bool OMXPlayerVideo::Close()
 
     StopThread();
   }
+  ReleaseStale();
 
   CloseDecoder();
 
@@ -208,7 +211,7 @@ bool OMXPlayerVideo::Decode(OMXPacket *pkt)
   while((int) m_decoder->GetFreeSpace() < pkt->size)
   {
     OMXClock::OMXSleep(10);
-    if(m_flush_requested) return true;
+    if(pkt->generation != m_generation) return true;
   }
 
   CLog::Log(LOGINFO, "CDVDPlayerVideo::Decode dts:%lld pts:%lld cur:%lld, size:%d", pkt->dts, pkt->pts, m_iCurrentPts, pkt->size);
@@ -219,31 +222,34 @@ bool OMXPlayerVideo::Decode(OMXPacket *pkt)
 void OMXPlayerVideo::Process()
 {
   OMXPacket *omx_pkt = NULL;
+  std::vector<std::deque<OMXPacket *>> stale;
 
   while(true)
   {
     Lock();
-    if(!(m_bStop || m_bAbort) && m_packets.empty())
+    if(!(m_bStop || m_bAbort) && m_packets.empty() && m_stale.empty() &&
+       m_decoder_generation == m_generation)
       pthread_cond_wait(&m_packet_cond, &m_lock);
 
     if (m_bStop || m_bAbort)
     {
       UnLock();
+      pthread_cond_broadcast(&m_flushed_cond);
       break;
     }
 
-    if(m_flush && omx_pkt)
-    {
-      delete omx_pkt;
-      omx_pkt = NULL;
-      m_flush = false;
-    }
-    else if(!omx_pkt && !m_packets.empty())
+    stale.swap(m_stale);
+    if(!omx_pkt && !m_packets.empty())
     {
       omx_pkt = m_packets.front();
       if (omx_pkt)
       {
         m_cached_size -= omx_pkt->size;
+        if(m_space_wanted && m_event_loop)
+        {
+          m_space_wanted = false;
+          m_event_loop->Wake();
+        }
       }
       else
       {
@@ -254,12 +260,18 @@ void OMXPlayerVideo::Process()
     }
     UnLock();
 
+    for(std::deque<OMXPacket *> &packets : stale)
+      for(OMXPacket *pkt : packets)
+        delete pkt;
+    stale.clear();
+
     LockDecoder();
-    if(m_flush && omx_pkt)
+    if(m_decoder_generation != m_generation)
+      FlushDecoder();
+    if(omx_pkt && omx_pkt->generation != m_generation)
     {
       delete omx_pkt;
       omx_pkt = NULL;
-      m_flush = false;
     }
     else if(omx_pkt && Decode(omx_pkt))
     {
@@ -273,25 +285,81 @@ void OMXPlayerVideo::Process()
     delete omx_pkt;
 }
 
+// Only swaps the queue out, so it never waits on a Decode in progress
 void OMXPlayerVideo::Flush()
 {
-  m_flush_requested = true;
   Lock();
-  LockDecoder();
-  m_flush_requested = false;
-  m_flush = true;
-  while (!m_packets.empty())
-  {
-    OMXPacket *pkt = m_packets.front(); 
-    m_packets.pop_front();
-    delete pkt;
-  }
+  m_generation++;
+  m_stale.emplace_back();
+  m_stale.back().swap(m_packets);
   m_iCurrentPts = AV_NOPTS_VALUE;
   m_cached_size = 0;
+  UnLock();
+  pthread_cond_broadcast(&m_packet_cond);
+}
+
+// Called by the decode thread with the decoder locked
+void OMXPlayerVideo::FlushDecoder()
+{
+  unsigned int generation = m_generation;
   if(m_decoder)
     m_decoder->Reset();
-  UnLockDecoder();
+  Lock();
+  // Decode may have set it from a pre-flush packet after Flush cleared it
+  m_iCurrentPts = AV_NOPTS_VALUE;
+  m_decoder_generation = generation;
+  UnLock();
+  pthread_cond_broadcast(&m_flushed_cond);
+}
+
+void OMXPlayerVideo::WaitFlushed()
+{
+  Lock();
+  while(m_decoder_generation != m_generation && Running() && !(m_bStop || m_bAbort))
+    pthread_cond_wait(&m_flushed_cond, &m_lock);
+  UnLock();
+}
+
+// Frees what Flush left behind once the decode thread is gone
+void OMXPlayerVideo::ReleaseStale()
+{
+  for(std::deque<OMXPacket *> &packets : m_stale)
+    for(OMXPacket *pkt : packets)
+      delete pkt;
+  m_stale.clear();
+}
+
+bool OMXPlayerVideo::SkipTo(int64_t target, int64_t &start)
+{
+  Lock();
+
+  std::deque<OMXPacket *>::iterator it;
+  for (it = m_packets.begin(); it != m_packets.end() && *it; ++it)
+  {
+    int64_t pts = (*it)->pts != AV_NOPTS_VALUE ? (*it)->pts : (*it)->dts;
+    if (((*it)->flags & AV_PKT_FLAG_KEY) && pts != AV_NOPTS_VALUE && pts >= target)
+      break;
+  }
+
+  bool found = it != m_packets.end() && *it;
+  if (found)
+  {
+    start = (*it)->pts != AV_NOPTS_VALUE ? (*it)->pts : (*it)->dts;
+    m_generation++;
+    m_stale.emplace_back(m_packets.begin(), it);
+    for (OMXPacket *pkt : m_stale.back())
+      m_cached_size -= pkt->size;
+    m_packets.erase(m_packets.begin(), it);
+    for (OMXPacket *pkt : m_packets)
+      if (pkt)
+        pkt->generation = m_generation;
+    m_iCurrentPts = AV_NOPTS_VALUE;
+  }
+
   UnLock();
+  if (found)
+    pthread_cond_broadcast(&m_packet_cond);
+  return found;
 }
 
 bool OMXPlayerVideo::AddPacket(OMXPacket *pkt)
@@ -304,15 +372,20 @@ bool OMXPlayerVideo::AddPacket(OMXPacket *pkt)
   if(m_bStop || m_bAbort)
     return ret;
 
+  Lock();
   if((m_cached_size + pkt->size) < m_config.queue_size * 1024 * 1024)
   {
-    Lock();
+    pkt->generation = m_generation;
     m_cached_size += pkt->size;
     m_packets.push_back(pkt);
-    UnLock();
     ret = true;
-    pthread_cond_broadcast(&m_packet_cond);
   }
+  else
+    m_space_wanted = true;
+  UnLock();
+
+  if(ret)
+    pthread_cond_broadcast(&m_packet_cond);
 
   return ret;
 }
@@ -31,8 +31,10 @@
 #include "OMXStreamInfo.h"
 #include "OMXVideo.h"
 #include "OMXThread.h"
+#include "OMXEventLoop.h"
 
 #include <deque>
+#include <vector>
 #include <sys/types.h>
 
 #include <string>
@@ -53,6 +55,7 @@ protected:
   int64_t                   m_iCurrentPts;
   pthread_cond_t            m_packet_cond;
   pthread_cond_t            m_picture_cond;
+  pthread_cond_t            m_flushed_cond;
   pthread_mutex_t           m_lock_decoder;
   OMXClock                  *m_av_clock;
   COMXVideo                 *m_decoder;
@@ -60,9 +63,16 @@ protected:
   double                    m_frametime;
   float                     m_display_aspect;
   bool                      m_bAbort;
-  bool                      m_flush;
-  std::atomic<bool>         m_flush_requested;
+  // Flush bumps the generation and hands the queue to m_stale. The decode
+  // thread drops packets of older generations, frees m_stale and resets the
+  // decoder once m_decoder_generation falls behind, then signals
+  // m_flushed_cond.
+  std::atomic<unsigned int> m_generation;
+  unsigned int              m_decoder_generation;
+  std::vector<std::deque<OMXPacket *>> m_stale;
   unsigned int              m_cached_size;
+  bool                      m_space_wanted;
+  OMXEventLoop              *m_event_loop;
   double                    m_iVideoDelay;
   OMXVideoConfig            m_config;
 
@@ -70,6 +80,8 @@ protected:
   void UnLock();
   void LockDecoder();
   void UnLockDecoder();
+  void FlushDecoder();
+  void ReleaseStale();
 private:
 public:
   OMXPlayerVideo();
@@ -80,7 +92,15 @@ public:
   bool Decode(OMXPacket *pkt);
   void Process() override;
   void Flush();
+  // Waits for the decode thread to reset the decoder after Flush or SkipTo,
+  // so that the delay and cache figures no longer count flushed data
+  void WaitFlushed();
+  // Drops queued packets before the first keyframe at or after target and
+  // returns its pts in start. Leaves the queue alone if none is queued yet.
+  bool SkipTo(int64_t target, int64_t &start);
   bool AddPacket(OMXPacket *pkt);
+  // Woken once a rejected AddPacket would fit again
+  void SetEventLoop(OMXEventLoop *event_loop) { m_event_loop = event_loop; }
   bool OpenDecoder();
   bool CloseDecoder();
   int  GetDecoderBufferSize();
@@ -51,6 +51,7 @@ OMXPacket::OMXPacket()
   data = NULL;
   stream_index = MAX_OMX_STREAMS;
   codec_type = AVMEDIA_TYPE_UNKNOWN;
+  generation = 0;
 }
 
 
@@ -71,6 +72,24 @@ OMXReader::OMXReader()
   m_eof           = false;
   m_chapter_count = 0;
   m_iCurrentPts   = AV_NOPTS_VALUE;
+  m_pLagFile      = NULL;
+  m_lagIoContext  = NULL;
+  m_pLagContext   = NULL;
+  m_lag_stream    = -1;
+  m_main_pkt      = NULL;
+  m_lag_pkt       = NULL;
+  m_interleave_limit[0] = m_interleave_limit[1] = 0;
+  m_back_buffer_size = 0;
+  m_back_buffer_max  = 0;
+  m_back_buffer_peak = 0;
+  m_back_queued      = 0;
+  m_back_pending     = 0;
+  m_back_replay      = 0;
+  m_back_seeks       = 0;
+  m_back_window_seeks = 0;
+  m_back_hits        = 0;
+  m_seeking          = false;
+  m_seek_cancelled   = false;
 
   for(int i = 0; i < MAX_STREAMS; i++)
     m_streams[i].extradata = NULL;
@@ -97,14 +116,17 @@ void OMXReader::UnLock()
   pthread_mutex_unlock(&m_lock);
 }
 
-static int interrupt_cb(void *unused)
+static int interrupt_cb(void *opaque)
 {
+  OMXReader *reader = (OMXReader *)opaque;
   int ret = 0;
   if (g_abort)
   {
     CLog::Log(LOGERROR, "COMXPlayer::interrupt_cb - Told to abort");
     ret = 1;
   }
+  else if (reader && reader->SeekInterrupted())
+    ret = 1;
   else if (timeout_duration && OMXClock::CurrentHostCounter() - timeout_start > timeout_duration)
   {
     CLog::Log(LOGERROR, "COMXPlayer::interrupt_cb - Timed out");
@@ -194,7 +216,7 @@ bool OMXReader::Open(
   m_speed       = DVD_PLAYSPEED_NORMAL;
   m_program     = UINT_MAX;
   m_DvdPlayer   = dvd;
-  const AVIOInterruptCB int_cb = { interrupt_cb, NULL };
+  const AVIOInterruptCB int_cb = { interrupt_cb, this };
   RESET_TIMEOUT(3);
 
   ClearStreams();
@@ -387,6 +409,9 @@ bool OMXReader::Open(
   }
 
   m_speed       = DVD_PLAYSPEED_NORMAL;
+  m_run_type    = AVMEDIA_TYPE_UNKNOWN;
+  m_run_bytes   = 0;
+  m_last_dts[0] = m_last_dts[1] = AV_NOPTS_VALUE;
 
   if(dump_format)
     m_dllAvFormat.av_dump_format(m_pFormatContext, 0, m_filename.c_str(), 0);
@@ -429,6 +454,17 @@ void OMXReader::ClearStreams()
 
 bool OMXReader::Close()
 {
+  CloseLagCursor();
+  m_interleave_limit[0] = m_interleave_limit[1] = 0;
+
+  if(m_back_buffer_max)
+    CLog::Log(LOGINFO, "OMXReader::Close - back buffer served %u of %u backward seeks, %u landed inside it, peak %uk played",
+      m_back_hits, m_back_seeks, m_back_window_seeks, m_back_buffer_peak >> 10);
+  ClearBackBuffer();
+  m_back_buffer_max  = 0;
+  m_back_buffer_peak = 0;
+  m_back_seeks = m_back_window_seeks = m_back_hits = 0;
+
   if (m_pFormatContext)
   {
     if (m_ioContext && m_pFormatContext->pb && m_pFormatContext->pb != m_ioContext)
@@ -496,9 +532,20 @@ bool OMXReader::SeekTime(double time, bool backwords, int64_t *startpts)
   if(time < 0)
     time = 0;
 
+  m_seek_cancelled = false;
+
   if(!m_pFormatContext)
     return false;
 
+  if(m_back_buffer_max && m_speed == DVD_PLAYSPEED_NORMAL)
+  {
+    Lock();
+    bool hit = SeekBackBuffer(DVD_SEC_TO_MICROSEC(time), backwords, startpts);
+    UnLock();
+    if(hit)
+      return true;
+  }
+
   if(m_pFile && !m_pFile->IoControl(IOCTRL_SEEK_POSSIBLE, NULL))
   {
     CLog::Log(LOGDEBUG, "%s - input stream reports it is not seekable", __FUNCTION__);
@@ -509,6 +556,9 @@ bool OMXReader::SeekTime(double time, bool backwords, int64_t *startpts)
 
   //FlushRead();
 
+  // what was read before no longer leads up to the demuxer position
+  ClearBackBuffer();
+
   if(m_ioContext)
     m_ioContext->buf_ptr = m_ioContext->buf_end;
 
@@ -517,11 +567,38 @@ bool OMXReader::SeekTime(double time, bool backwords, int64_t *startpts)
     seek_pts += m_pFormatContext->start_time;
 
   RESET_TIMEOUT(1);
+  m_seeking = true;
   int ret = m_dllAvFormat.av_seek_frame(m_pFormatContext, -1, seek_pts, backwords ? AVSEEK_FLAG_BACKWARD : 0);
+  m_seeking = false;
+
+  // a newer target is waiting, the caller seeks again so leave eof alone
+  if(m_seek_cancelled)
+  {
+    CLog::Log(LOGDEBUG, "OMXReader::SeekTime(%f) - cancelled", time);
+    UnLock();
+    return false;
+  }
 
   if(ret >= 0)
     UpdateCurrentPTS();
 
+  m_run_type  = AVMEDIA_TYPE_UNKNOWN;
+  m_run_bytes = 0;
+  m_last_dts[0] = m_last_dts[1] = AV_NOPTS_VALUE;
+
+  if(m_pLagContext)
+  {
+    if(m_lagIoContext)
+      m_lagIoContext->buf_ptr = m_lagIoContext->buf_end;
+    RESET_TIMEOUT(1);
+    m_dllAvFormat.av_seek_frame(m_pLagContext, -1, seek_pts, backwords ? AVSEEK_FLAG_BACKWARD : 0);
+    delete m_main_pkt;
+    delete m_lag_pkt;
+    m_main_pkt = m_lag_pkt = NULL;
+    m_main_eof = m_lag_eof = false;
+    m_lag_skip_dts = AV_NOPTS_VALUE;
+  }
+
   // in this case the start time is requested time
   if(startpts)
     *startpts = DVD_SEC_TO_MICROSEC(time);
@@ -541,48 +618,41 @@ bool OMXReader::SeekTime(double time, bool backwords, int64_t *startpts)
   return (ret >= 0);
 }
 
-OMXPacket *OMXReader::Read()
+OMXPacket *OMXReader::ReadPacket(AVFormatContext *context)
 {
   OMXPacket *m_omx_pkt = new OMXPacket;
 
   int       result = -1;
 
-  if(!m_pFormatContext || m_eof)
-    return NULL;
-
-  Lock();
-
   // assume we are not eof
-  if(m_pFormatContext->pb)
-    m_pFormatContext->pb->eof_reached = 0;
+  if(context->pb)
+    context->pb->eof_reached = 0;
 
   RESET_TIMEOUT(1);
-  result = m_dllAvFormat.av_read_frame(m_pFormatContext, m_omx_pkt);
+  result = m_dllAvFormat.av_read_frame(context, m_omx_pkt);
   if (result < 0)
   {
-    m_eof = true;
     //FlushRead();
     //m_dllAvCodec.av_packet_unref(&pkt);
-    UnLock();
+    delete m_omx_pkt;
     return NULL;
   }
 
-  if (m_omx_pkt->size < 0 || m_omx_pkt->stream_index >= MAX_OMX_STREAMS || interrupt_cb(NULL))
+  if (m_omx_pkt->size < 0 || m_omx_pkt->stream_index >= MAX_OMX_STREAMS ||
+      m_omx_pkt->stream_index >= (int)m_pFormatContext->nb_streams || interrupt_cb(NULL))
   {
     // XXX, in some cases ffmpeg returns a negative packet size
-    if(m_pFormatContext->pb && !m_pFormatContext->pb->eof_reached)
+    if(context->pb && !context->pb->eof_reached)
     {
       CLog::Log(LOGERROR, "OMXReader::Read no valid packet");
       //FlushRead();
     }
 
-    m_dllAvCodec.av_packet_unref(m_omx_pkt);
-
-    m_eof = true;
-    UnLock();
+    delete m_omx_pkt;
     return NULL;
   }
 
+  // both cursors demux the same file, the main context holds the stream info
   AVStream *pStream = m_pFormatContext->streams[m_omx_pkt->stream_index];
 
   /* only read packets for active streams */
@@ -644,14 +714,371 @@ OMXPacket *OMXReader::Read()
   m_omx_pkt->pts = ConvertTimestamp(m_omx_pkt->pts, pStream->time_base.den, pStream->time_base.num);
   m_omx_pkt->duration = DVD_SEC_TO_MICROSEC((double)m_omx_pkt->duration * pStream->time_base.num / pStream->time_base.den);
 
+  return m_omx_pkt;
+}
+
+// The time packets are ordered by: dts, or pts for streams that only have
+// that, like native matroska video
+static int64_t PacketTime(const OMXPacket *pkt)
+{
+  return pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+}
+
+// The time a packet is shown at: pts, or dts for streams that only have
+// that, like AVI video
+static int64_t PacketPts(const OMXPacket *pkt)
+{
+  return pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+}
+
+// Bytes of one stream type demuxed without a packet of the other. Once a run
+// outgrows its player queue the other stream starves, so give that one its
+// own cursor.
+void OMXReader::MeasureInterleave(OMXPacket *pkt)
+{
+  int slot;
+
+  if(pkt->codec_type == AVMEDIA_TYPE_AUDIO)
+    slot = 0;
+  else if(pkt->codec_type == AVMEDIA_TYPE_VIDEO)
+    slot = 1;
+  else
+    return;
+
+  if(!IsActive(pkt->stream_index))
+    return;
+
+  if(PacketTime(pkt) != AV_NOPTS_VALUE)
+    m_last_dts[slot] = PacketTime(pkt);
+
+  if(m_run_type != pkt->codec_type)
+  {
+    m_run_type  = pkt->codec_type;
+    m_run_bytes = 0;
+  }
+  m_run_bytes += pkt->size;
+
+  if(m_pLagContext || !m_interleave_limit[slot] || m_run_bytes <= m_interleave_limit[slot])
+    return;
+
+  CLog::Log(LOGINFO, "OMXReader::Read - %u bytes of %s in a row, reading %s through a second cursor",
+    m_run_bytes, slot ? "video" : "audio", slot ? "audio" : "video");
+  if(!OpenLagCursor(slot ? OMXSTREAM_AUDIO : OMXSTREAM_VIDEO))
+    m_interleave_limit[0] = m_interleave_limit[1] = 0;
+}
+
+OMXPacket *OMXReader::Read()
+{
+  OMXPacket *m_omx_pkt = NULL;
+
+  if(!m_pFormatContext)
+    return NULL;
+
+  Lock();
+
+  if(m_back_replay < m_back_buffer.size())
+  {
+    m_back_pending -= m_back_buffer[m_back_replay]->size;
+    m_omx_pkt = CopyPacket(m_back_buffer[m_back_replay++]);
+    UnLock();
+    return m_omx_pkt;
+  }
+
+  if(m_eof)
+  {
+    UnLock();
+    return NULL;
+  }
+
+  if(!m_pLagContext)
+  {
+    m_omx_pkt = ReadPacket(m_pFormatContext);
+    if(m_omx_pkt)
+      MeasureInterleave(m_omx_pkt);
+    else
+      m_eof = true;
+  }
+  else
+  {
+    if(!m_main_pkt && !m_main_eof)
+      m_main_eof = !(m_main_pkt = ReadPacket(m_pFormatContext));
+
+    while(!m_lag_pkt && !m_lag_eof)
+    {
+      m_lag_eof = !(m_lag_pkt = ReadPacket(m_pLagContext));
+      // skip what the main cursor delivered before the split
+      if(m_lag_pkt && m_lag_skip_dts != AV_NOPTS_VALUE && PacketTime(m_lag_pkt) != AV_NOPTS_VALUE)
+      {
+        if(PacketTime(m_lag_pkt) <= m_lag_skip_dts)
+        {
+          delete m_lag_pkt;
+          m_lag_pkt = NULL;
+        }
+        else
+          m_lag_skip_dts = AV_NOPTS_VALUE;
+      }
+    }
+
+    // merge by time, packets without one go out as soon as they are read
+    int64_t main_time = m_main_pkt ? PacketTime(m_main_pkt) : AV_NOPTS_VALUE;
+    int64_t lag_time  = m_lag_pkt ? PacketTime(m_lag_pkt) : AV_NOPTS_VALUE;
+    bool lag_first = m_lag_pkt && (!m_main_pkt || lag_time == AV_NOPTS_VALUE ||
+      (main_time != AV_NOPTS_VALUE && lag_time < main_time));
+    OMXPacket **next = lag_first ? &m_lag_pkt : &m_main_pkt;
+    m_omx_pkt = *next;
+    *next = NULL;
+
+    if(!m_omx_pkt)
+      m_eof = true;
+  }
+
   // used to guess streamlength
-  if (m_omx_pkt->dts != AV_NOPTS_VALUE && (m_omx_pkt->dts > m_iCurrentPts || m_iCurrentPts == AV_NOPTS_VALUE))
+  if (m_omx_pkt && m_omx_pkt->dts != AV_NOPTS_VALUE && (m_omx_pkt->dts > m_iCurrentPts || m_iCurrentPts == AV_NOPTS_VALUE))
     m_iCurrentPts = m_omx_pkt->dts;
 
+  if(m_omx_pkt && m_back_buffer_max && m_speed == DVD_PLAYSPEED_NORMAL)
+    KeepPacket(m_omx_pkt);
+
   UnLock();
   return m_omx_pkt;
 }
 
+void OMXReader::SetBackBuffer(unsigned int bytes)
+{
+  Lock();
+  m_back_buffer_max = bytes;
+  if(!bytes)
+    ClearBackBuffer();
+  UnLock();
+}
+
+void OMXReader::SetBackBufferQueued(unsigned int bytes)
+{
+  Lock();
+  m_back_queued = bytes;
+  UnLock();
+}
+
+unsigned int OMXReader::GetBackBufferSize()
+{
+  unsigned int unplayed = m_back_pending + m_back_queued;
+  return m_back_buffer_size > unplayed ? m_back_buffer_size - unplayed : 0;
+}
+
+OMXPacket *OMXReader::CopyPacket(const OMXPacket *src)
+{
+  OMXPacket *pkt = new OMXPacket;
+
+  // shares the payload when the demuxer handed out a refcounted one
+  if(m_dllAvCodec.av_packet_ref(pkt, src) < 0)
+  {
+    delete pkt;
+    return NULL;
+  }
+  pkt->hints      = src->hints;
+  pkt->codec_type = src->codec_type;
+  return pkt;
+}
+
+void OMXReader::KeepPacket(const OMXPacket *pkt)
+{
+  OMXPacket *copy = CopyPacket(pkt);
+  if(!copy)
+    return;
+
+  m_back_buffer.push_back(copy);
+  m_back_buffer_size += copy->size;
+
+  // The newest packets are still queued for the decoders, so the ring
+  // holds those on top of m_back_buffer_max bytes of played ones
+  while(m_back_buffer_size > m_back_buffer_max + m_back_queued && m_back_buffer.size() > 1)
+  {
+    m_back_buffer_size -= m_back_buffer.front()->size;
+    delete m_back_buffer.front();
+    m_back_buffer.pop_front();
+  }
+
+  m_back_replay  = m_back_buffer.size();
+  m_back_pending = 0;
+  if(GetBackBufferSize() > m_back_buffer_peak)
+    m_back_buffer_peak = GetBackBufferSize();
+}
+
+// Replays the back buffer from the last entry point at or before pts: a video
+// keyframe of the active stream, or any packet of the active audio stream
+// for audio only files. Every backward seek counts towards the hit rate, so
+// targets older than the ring show up as misses when it is too small.
+bool OMXReader::SeekBackBuffer(int64_t pts, bool backwords, int64_t *startpts)
+{
+  if(backwords)
+    m_back_seeks++;
+
+  if(m_back_buffer.empty() || PacketPts(m_back_buffer.back()) == AV_NOPTS_VALUE ||
+     pts > PacketPts(m_back_buffer.back()))
+    return false;
+
+  if(backwords)
+  {
+    for(const OMXPacket *pkt : m_back_buffer)
+    {
+      if(PacketPts(pkt) == AV_NOPTS_VALUE)
+        continue;
+      if(pts >= PacketPts(pkt))
+        m_back_window_seeks++;
+      break;
+    }
+  }
+
+  int video = GetVideoIndex();
+  int audio = GetAudioIndex();
+  for(size_t i = m_back_buffer.size(); i-- > 0;)
+  {
+    const OMXPacket *pkt = m_back_buffer[i];
+    if(PacketPts(pkt) == AV_NOPTS_VALUE || PacketPts(pkt) > pts)
+      continue;
+
+    bool entry = video >= 0 ? pkt->stream_index == video && (pkt->flags & AV_PKT_FLAG_KEY)
+                            : pkt->stream_index == audio;
+    if(!entry)
+      continue;
+
+    m_back_replay  = i;
+    m_back_pending = 0;
+    for(; i < m_back_buffer.size(); i++)
+      m_back_pending += m_back_buffer[i]->size;
+    if(backwords)
+      m_back_hits++;
+    m_eof = false;
+    if(startpts)
+      *startpts = PacketPts(pkt);
+    CLog::Log(LOGDEBUG, "OMXReader::SeekTime - replaying %u packets from %.3f", (unsigned int)(m_back_buffer.size() - m_back_replay), PacketPts(pkt) * 1e-6);
+    return true;
+  }
+  return false;
+}
+
+void OMXReader::ClearBackBuffer()
+{
+  for(OMXPacket *pkt : m_back_buffer)
+    delete pkt;
+  m_back_buffer.clear();
+  m_back_buffer_size = 0;
+  m_back_pending = 0;
+  m_back_replay = 0;
+}
+
+bool OMXReader::SeekInterrupted()
+{
+  if(!m_seeking)
+    return false;
+  if(!m_seek_cancelled && m_seek_cancel && m_seek_cancel())
+    m_seek_cancelled = true;
+  return m_seek_cancelled;
+}
+
+void OMXReader::SetInterleaveLimits(unsigned int video_bytes, unsigned int audio_bytes)
+{
+  Lock();
+  m_interleave_limit[0] = audio_bytes;
+  m_interleave_limit[1] = video_bytes;
+  UnLock();
+}
+
+bool OMXReader::OpenLagCursor(OMXStreamType type)
+{
+  const AVIOInterruptCB int_cb = { interrupt_cb, this };
+  unsigned char *buffer;
+  int index = type == OMXSTREAM_AUDIO ? m_audio_index : m_video_index;
+  int64_t dts = m_last_dts[type == OMXSTREAM_AUDIO ? 0 : 1];
+
+  // only plain seekable files can be opened twice
+  if(!m_pFile || m_DvdPlayer || index < 0 || !m_ioContext || !m_ioContext->seekable)
+    return false;
+
+  m_lag_stream = -1;
+
+  m_pLagFile = new CFile();
+  if(!m_pLagFile->Open(m_filename, READ_TRUNCATED | READ_BITRATE | READ_CHUNKED))
+  {
+    CloseLagCursor();
+    return false;
+  }
+
+  buffer = (unsigned char*)m_dllAvUtil.av_malloc(FFMPEG_FILE_BUFFER_SIZE);
+  m_lagIoContext = m_dllAvFormat.avio_alloc_context(buffer, FFMPEG_FILE_BUFFER_SIZE, 0, m_pLagFile, dvd_file_read, NULL, dvd_file_seek);
+  m_lagIoContext->max_packet_size = m_ioContext->max_packet_size;
+
+  m_pLagContext = m_dllAvFormat.avformat_alloc_context();
+  m_pLagContext->interrupt_callback = int_cb;
+  m_pLagContext->pb = m_lagIoContext;
+  RESET_TIMEOUT(3);
+  if(m_dllAvFormat.avformat_open_input(&m_pLagContext, m_filename.c_str(), m_pFormatContext->iformat, NULL) < 0 ||
+     m_pLagContext->nb_streams != m_pFormatContext->nb_streams)
+  {
+    CLog::Log(LOGERROR, "OMXReader::OpenLagCursor - failed to open %s", m_filename.c_str());
+    CloseLagCursor();
+    return false;
+  }
+
+  m_lag_type = type;
+  m_lag_stream = -1;
+  SetLagStream(m_streams[index].id);
+
+  // pick up from the last packet already delivered for that stream
+  int64_t seek_pts = dts == AV_NOPTS_VALUE ? m_iCurrentPts : dts;
+  if(seek_pts == AV_NOPTS_VALUE)
+    seek_pts = 0;
+  if(m_pFormatContext->start_time != (int64_t)AV_NOPTS_VALUE)
+    seek_pts += m_pFormatContext->start_time;
+  RESET_TIMEOUT(1);
+  m_dllAvFormat.av_seek_frame(m_pLagContext, -1, seek_pts, AVSEEK_FLAG_BACKWARD);
+
+  m_lag_skip_dts = dts;
+  m_main_pkt = m_lag_pkt = NULL;
+  m_main_eof = m_lag_eof = false;
+  return true;
+}
+
+// Moves a stream from the main cursor to the lag cursor
+void OMXReader::SetLagStream(int stream)
+{
+  if(m_lag_stream >= 0)
+    m_pFormatContext->streams[m_lag_stream]->discard = AVDISCARD_NONE;
+
+  m_lag_stream = stream;
+  for(unsigned int i = 0; i < m_pLagContext->nb_streams; i++)
+    m_pLagContext->streams[i]->discard = (int)i == stream ? AVDISCARD_NONE : AVDISCARD_ALL;
+  m_pFormatContext->streams[stream]->discard = AVDISCARD_ALL;
+}
+
+void OMXReader::CloseLagCursor()
+{
+  if(m_pLagContext && m_lag_stream >= 0 && m_pFormatContext)
+    m_pFormatContext->streams[m_lag_stream]->discard = AVDISCARD_NONE;
+
+  if(m_pLagContext)
+    m_dllAvFormat.avformat_close_input(&m_pLagContext);
+  if(m_lagIoContext)
+  {
+    m_dllAvUtil.av_free(m_lagIoContext->buffer);
+    m_dllAvUtil.av_free(m_lagIoContext);
+  }
+  if(m_pLagFile)
+  {
+    m_pLagFile->Close();
+    delete m_pLagFile;
+  }
+  delete m_main_pkt;
+  delete m_lag_pkt;
+
+  m_pLagContext  = NULL;
+  m_lagIoContext = NULL;
+  m_pLagFile     = NULL;
+  m_main_pkt     = NULL;
+  m_lag_pkt      = NULL;
+  m_lag_stream   = -1;
+}
+
 bool OMXReader::GetStreams(bool dump_format)
 {
   if(!m_pFormatContext)
@@ -1027,6 +1454,8 @@ bool OMXReader::SetActiveStream(OMXStreamType type, unsigned int index)
   bool ret = false;
   Lock();
   ret = SetActiveStreamInternal(type, index);
+  if(ret && m_pLagContext && type == m_lag_type)
+    SetLagStream(m_streams[type == OMXSTREAM_AUDIO ? m_audio_index : m_video_index].id);
   UnLock();
   return ret;
 }
@@ -1123,6 +1552,21 @@ void OMXReader::SetSpeed(int iSpeed)
   else if(m_speed < DVD_PLAYSPEED_PAUSE)
     discard = AVDISCARD_NONKEY;
 
+  // trick play only reads video, a single cursor will do
+  if(discard != AVDISCARD_NONE && m_pLagContext)
+  {
+    Lock();
+    CloseLagCursor();
+    UnLock();
+  }
+
+  if(m_speed != DVD_PLAYSPEED_NORMAL && !m_back_buffer.empty())
+  {
+    Lock();
+    ClearBackBuffer();
+    UnLock();
+  }
+
   for(unsigned int i = 0; i < m_pFormatContext->nb_streams; i++)
   {
     if(m_pFormatContext->streams[i])
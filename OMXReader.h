@@ -28,6 +28,7 @@
 #include "OMXStreamInfo.h"
 #include "OMXThread.h"
 #include <queue>
+#include <deque>
 
 #include "OMXStreamInfo.h"
 #include "OMXDvdPlayer.h"
@@ -36,6 +37,7 @@
 
 #include <sys/types.h>
 #include <string>
+#include <functional>
 
 using namespace XFILE;
 using namespace std;
@@ -61,6 +63,7 @@ class OMXPacket : public AVPacket
   
   COMXStreamInfo hints;
   enum AVMediaType codec_type;
+  unsigned int generation;  // flush generation of the player queue it is in
 };
 
 enum OMXStreamType
@@ -120,6 +123,53 @@ protected:
   bool SetActiveStreamInternal(OMXStreamType type, unsigned int index);
   bool                      m_seek;
   OMXDvdPlayer              *m_DvdPlayer;
+  // Second cursor on the same file for the stream the main one lags on,
+  // opened when audio and video are interleaved further apart than the
+  // player queues hold. Packets from both are merged by dts, or pts where
+  // a stream has no dts. m_last_dts holds the same time.
+  XFILE::CFile              *m_pLagFile;
+  AVIOContext               *m_lagIoContext;
+  AVFormatContext           *m_pLagContext;
+  OMXStreamType             m_lag_type;
+  int                       m_lag_stream;
+  int64_t                   m_lag_skip_dts;
+  OMXPacket                 *m_main_pkt;
+  OMXPacket                 *m_lag_pkt;
+  bool                      m_main_eof;
+  bool                      m_lag_eof;
+  // Interleave distance: bytes of one stream type demuxed in a row
+  enum AVMediaType          m_run_type;
+  unsigned int              m_run_bytes;
+  unsigned int              m_interleave_limit[2];
+  int64_t                   m_last_dts[2];
+  OMXPacket *ReadPacket(AVFormatContext *context);
+  void MeasureInterleave(OMXPacket *pkt);
+  bool OpenLagCursor(OMXStreamType type);
+  void CloseLagCursor();
+  void SetLagStream(int stream);
+  // Copies of recently read packets, so short backward seeks replay them
+  // instead of seeking the demuxer. Packets still queued for the decoders
+  // (m_back_queued bytes) or not replayed yet (m_back_pending bytes) haven't
+  // been played, the ring keeps up to m_back_buffer_max bytes on top of them.
+  // m_back_replay is the next one to hand out again.
+  std::deque<OMXPacket *>   m_back_buffer;
+  unsigned int              m_back_buffer_size;
+  unsigned int              m_back_buffer_max;
+  unsigned int              m_back_buffer_peak;
+  unsigned int              m_back_queued;
+  unsigned int              m_back_pending;
+  size_t                    m_back_replay;
+  unsigned int              m_back_seeks;
+  unsigned int              m_back_window_seeks;
+  unsigned int              m_back_hits;
+  OMXPacket *CopyPacket(const OMXPacket *src);
+  void KeepPacket(const OMXPacket *pkt);
+  bool SeekBackBuffer(int64_t pts, bool backwords, int64_t *startpts);
+  void ClearBackBuffer();
+  // Polled through interrupt_cb while av_seek_frame runs, true abandons it
+  std::function<bool()>     m_seek_cancel;
+  bool                      m_seeking;
+  bool                      m_seek_cancelled;
 
 private:
 public:
@@ -132,7 +182,19 @@ public:
   bool Close();
   //void FlushRead();
   bool SeekTime(double time, bool backwords, int64_t *startpts);
+  void SetSeekCancel(std::function<bool()> cancel) { m_seek_cancel = cancel; };
+  // Whether the last SeekTime failed because it was cancelled
+  bool SeekCancelled() { return m_seek_cancelled; };
+  bool SeekInterrupted();
   OMXPacket *Read();
+  void SetInterleaveLimits(unsigned int video_bytes, unsigned int audio_bytes);
+  void SetBackBuffer(unsigned int bytes);
+  // Bytes read but not played yet, queued for or by the players
+  void SetBackBufferQueued(unsigned int bytes);
+  // Bytes of played packets in the back buffer, the window backward seeks can use
+  unsigned int GetBackBufferSize();
+  // Percentage of backward seeks the back buffer served
+  unsigned int GetBackBufferHitRate() { return m_back_seeks ? 100 * m_back_hits / m_back_seeks : 0; };
   bool GetStreams(bool dump_format = false);
   void AddStream(int id);
   bool IsActive(int stream_index);
@@ -0,0 +1,63 @@
+#include "SoftClock.h"
+
+SoftClock::SoftClock()
+{
+  m_running      = false;
+  m_scale        = 0x10000;
+  m_step         = 1000000 / 25;
+  // reference errors below this are slewed
+  m_slew_limit   = 1000000 / 50;
+  m_anchor_media = 0;
+  m_anchor_host  = 0;
+}
+
+void SoftClock::Start(int64_t media, int64_t now)
+{
+  m_running = true;
+  SetMediaTime(media, now);
+}
+
+void SoftClock::Stop(int64_t now)
+{
+  SetMediaTime(GetMediaTime(now), now);
+  m_running = false;
+}
+
+int64_t SoftClock::GetMediaTime(int64_t now)
+{
+  if (!m_running)
+    return m_anchor_media;
+  return m_anchor_media + (((now - m_anchor_host) * m_scale) >> 16);
+}
+
+void SoftClock::SetMediaTime(int64_t media, int64_t now)
+{
+  m_anchor_media = media;
+  m_anchor_host  = now;
+}
+
+void SoftClock::SetScale(int32_t scale, int64_t now)
+{
+  // re-anchor so the time already played keeps the old scale
+  SetMediaTime(GetMediaTime(now), now);
+  m_scale = scale;
+}
+
+void SoftClock::Step(int frames, int64_t now)
+{
+  SetMediaTime(GetMediaTime(now) + frames * m_step, now);
+}
+
+void SoftClock::Reference(int64_t ref, int64_t now)
+{
+  if (!m_running)
+  {
+    SetMediaTime(ref, now);
+    return;
+  }
+  int64_t media = GetMediaTime(now);
+  int64_t error = ref - media;
+  if (error > -m_slew_limit && error < m_slew_limit)
+    error /= 8;
+  SetMediaTime(media + error, now);
+}
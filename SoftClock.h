@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+// Media time of the software clock, kept against a host clock [us] that
+// the caller passes in. The time advances at scale (16.16 fixed point,
+// 0 pauses) while running, and follows the reference timestamps of the
+// master stream: small errors are slewed to hide their jitter, large
+// ones are jumped.
+class SoftClock
+{
+public:
+  SoftClock();
+  void Start(int64_t media, int64_t now);
+  // Freezes the media time where it is
+  void Stop(int64_t now);
+  bool IsRunning() { return m_running; }
+  int64_t GetMediaTime(int64_t now);
+  void SetMediaTime(int64_t media, int64_t now);
+  int32_t GetScale() { return m_scale; }
+  void SetScale(int32_t scale, int64_t now);
+  // Advances the media time by frames steps, also while paused
+  void Step(int frames, int64_t now);
+  void Reference(int64_t ref, int64_t now);
+
+private:
+  bool    m_running;
+  int32_t m_scale;
+  int64_t m_step;
+  int64_t m_slew_limit;
+  int64_t m_anchor_media;
+  int64_t m_anchor_host;
+};
@@ -25,60 +25,310 @@
 // DEALINGS IN THE SOFTWARE.
 
 #include "Srt.h"
+#include "utils/log.h"
 
-#include <fstream>
+#include <algorithm>
 #include <utility>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace {
-  unsigned int timecode_to_milliseconds(unsigned int h,
-                                        unsigned int m,
-                                        unsigned int s,
-                                        unsigned int f)
+  const char* skip_space(const char* p, const char* end)
   {
-    return h*3600000 +
-           m*60000 +
-           s*1000 +
-           f;
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
   }
+
+  // [h:]mm:ss[,.]fff as in SRT and WebVTT, or h:mm:ss.cc as in ASS
+  bool read_timecode(const char*& p, const char* end, int& ms)
+  {
+    unsigned int fields[3];
+    int n = 0;
+
+    p = skip_space(p, end);
+    for (;;) {
+      if (p == end || *p < '0' || *p > '9') return false;
+      unsigned int v = 0;
+      while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+      fields[n++] = v;
+      if (n == 3 || p == end || *p != ':') break;
+      ++p;
+    }
+    if (n < 2) return false;
+
+    unsigned int fraction = 0;
+    if (p < end && (*p == ',' || *p == '.')) {
+      ++p;
+      int digits = 0;
+      for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+        if (digits < 3) fraction = fraction * 10 + (*p - '0');
+      for (; digits < 3; ++digits)
+        fraction *= 10;
+    }
+
+    unsigned int h = n == 3 ? fields[0] : 0;
+    unsigned int m = fields[n - 2];
+    unsigned int s = fields[n - 1];
+    ms = (int) (h*3600000 + m*60000 + s*1000 + fraction);
+    return true;
+  }
+
+  bool starts_with(const char* p, const char* end, const char* prefix)
+  {
+    size_t len = strlen(prefix);
+    return (size_t) (end - p) >= len && strncasecmp(p, prefix, len) == 0;
+  }
+}
+
+SubtitleFileReader::SubtitleFileReader()
+: m_data(),
+  m_size(),
+  m_pos(),
+  m_format(SRT),
+  m_in_events(),
+  m_start_field(1),
+  m_end_field(2),
+  m_text_field(9),
+  m_last_start(),
+  m_reordered(),
+  m_cues()
+{}
+
+SubtitleFileReader::~SubtitleFileReader()
+{
+  Close();
 }
 
-template <typename T, typename U>
-T& getline(T&& input, U&& str) {
-  std::getline(std::forward<T>(input), std::forward<U>(str));
-  if (!str.empty() && str.back() == '\r') {
-    str.resize(str.size()-1);
+bool SubtitleFileReader::Open(const std::string& filename)
+{
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return false;
   }
-  return input;
+
+  m_size = st.st_size;
+  if (m_size > 0) {
+    void* data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = (const char*) data;
+  }
+  close(fd);
+
+  // an empty file is read as having no cues
+  m_filename = filename;
+  m_open_time = std::chrono::steady_clock::now();
+  m_pos = m_data;
+  const char* end = m_data + m_size;
+
+  // UTF-8 byte order mark
+  if (starts_with(m_pos, end, "\xEF\xBB\xBF"))
+    m_pos += 3;
+
+  size_t dot = filename.find_last_of('.');
+  std::string extension = dot == std::string::npos ? "" : filename.substr(dot);
+  m_format = starts_with(m_pos, end, "[Script Info]") ||
+             strcasecmp(extension.c_str(), ".ass") == 0 ||
+             strcasecmp(extension.c_str(), ".ssa") == 0 ? ASS : SRT;
+  m_in_events = false;
+  m_start_field = 1;
+  m_end_field = 2;
+  m_text_field = 9;
+  m_last_start = 0;
+  m_reordered = false;
+  m_held.clear();
+  m_cues = 0;
+  return true;
 }
 
-bool ReadSrt(const std::string& filename, std::vector<Subtitle>& subtitles) {
-  std::ifstream srt(filename);
-  if (!srt) return false;
+void SubtitleFileReader::Close()
+{
+  if (m_data)
+    munmap((void*) m_data, m_size);
+  m_data = m_pos = NULL;
+  m_size = 0;
+}
 
-  for (std::string line; getline(srt, line);) {
-    unsigned int h, m, s, f, h2, m2, s2, f2;
+bool SubtitleFileReader::NextLine(const char*& line, const char*& line_end)
+{
+  const char* end = m_data + m_size;
+  if (!m_pos || m_pos >= end) return false;
 
-    if (sscanf(line.c_str(), "%u:%u:%u,%u --> %u:%u:%u,%u",
-               &h, &m, &s, &f, &h2, &m2, &s2, &f2)
-        != 8)
-    {
-      continue;
+  line = m_pos;
+  line_end = (const char*) memchr(m_pos, '\n', end - m_pos);
+  if (line_end) {
+    m_pos = line_end + 1;
+  } else {
+    line_end = m_pos = end;
+  }
+  if (line_end > line && line_end[-1] == '\r')
+    --line_end;
+  return true;
+}
+
+bool SubtitleFileReader::Read(std::vector<Subtitle>& subtitles, size_t max_cues)
+{
+  m_reordered = false;
+  if (!m_pos) return false;
+
+  for (size_t cues = 0; cues < max_cues; cues++) {
+    bool more = m_format == ASS ? ReadDialogue(subtitles) : ReadCue(subtitles);
+    if (!more) {
+      Finish(subtitles);
+      return false;
+    }
+  }
+  return true;
+}
+
+// An SRT or WebVTT cue: a timing line followed by text up to a blank line.
+// Anything else, like numbers, headers and notes, is skipped.
+bool SubtitleFileReader::ReadCue(std::vector<Subtitle>& subtitles)
+{
+  const char *line, *line_end;
+
+  while (NextLine(line, line_end)) {
+    const char* arrow = NULL;
+    for (const char* p = line; p + 3 <= line_end; ++p) {
+      if (p[0] == '-' && p[1] == '-' && p[2] == '>') {
+        arrow = p;
+        break;
+      }
     }
+    if (!arrow) continue;
 
-    auto start = (int) timecode_to_milliseconds(h, m, s, f);
-    auto stop = (int) timecode_to_milliseconds(h2, m2, s2 ,f2);
+    int start, stop;
+    const char* p = line;
+    if (!read_timecode(p, arrow, start)) continue;
+    p = arrow + 3;
+    if (!read_timecode(p, line_end, stop)) continue;
 
     std::vector<std::string> text_lines;
-    while (getline(srt, line)) {
-      if (line.empty()) break;
-      text_lines.push_back(std::move(line));
+    while (NextLine(line, line_end) && line != line_end)
+      text_lines.emplace_back(line, line_end);
+
+    Add(subtitles, start, stop, text_lines);
+    return true;
+  }
+  return false;
+}
+
+// Dialogue lines of the [Events] section, laid out as its Format line says
+bool SubtitleFileReader::ReadDialogue(std::vector<Subtitle>& subtitles)
+{
+  const char *line, *line_end;
+
+  while (NextLine(line, line_end)) {
+    if (*line == '[') {
+      m_in_events = starts_with(line, line_end, "[Events]");
+      continue;
+    }
+    if (!m_in_events) continue;
+
+    bool format = starts_with(line, line_end, "Format:");
+    if (!format && !starts_with(line, line_end, "Dialogue:")) continue;
+
+    // split on the commas before the text, which may hold commas itself
+    const char* p = (const char*) memchr(line, ':', line_end - line) + 1;
+    const char* fields[16];
+    const char* fields_end[16];
+    int n = 0;
+    while (n < 16) {
+      const char* comma = n == m_text_field && !format ? NULL
+                        : (const char*) memchr(p, ',', line_end - p);
+      fields[n] = skip_space(p, line_end);
+      fields_end[n] = comma ? comma : line_end;
+      n++;
+      if (!comma) break;
+      p = comma + 1;
     }
 
-    if (!subtitles.empty() && subtitles.back().stop > stop)
+    if (format) {
+      for (int i = 0; i < n; i++) {
+        const char* name = fields[i];
+        const char* name_end = fields_end[i];
+        while (name_end > name && (name_end[-1] == ' ' || name_end[-1] == '\t')) --name_end;
+        std::string field(name, name_end);
+        if (field == "Start") m_start_field = i;
+        else if (field == "End") m_end_field = i;
+        else if (field == "Text") m_text_field = i;
+      }
       continue;
+    }
+
+    if (n <= m_text_field || n <= m_start_field || n <= m_end_field) continue;
 
-    subtitles.emplace_back(start, stop, text_lines);
+    int start, stop;
+    p = fields[m_start_field];
+    if (!read_timecode(p, fields_end[m_start_field], start)) continue;
+    p = fields[m_end_field];
+    if (!read_timecode(p, fields_end[m_end_field], stop)) continue;
+
+    // lines are broken with \N
+    std::vector<std::string> text_lines;
+    const char* text = fields[m_text_field];
+    const char* text_end = fields_end[m_text_field];
+    for (p = text; p < text_end; ++p) {
+      if (p + 1 < text_end && p[0] == '\\' && p[1] == 'N') {
+        if (p > text) text_lines.emplace_back(text, p);
+        text = ++p + 1;
+      }
+    }
+    if (text_end > text) text_lines.emplace_back(text, text_end);
+    if (text_lines.empty()) continue;
+
+    Add(subtitles, start, stop, text_lines);
+    return true;
   }
+  return false;
+}
 
-  return true;
+void SubtitleFileReader::Add(std::vector<Subtitle>& subtitles, int start, int stop,
+                             std::vector<std::string>& text_lines)
+{
+  m_cues++;
+
+  // The render loop needs cues in order of start time. Once a cue starts
+  // early the rest are held back and sorted when the file is done.
+  if (m_held.empty() && start >= m_last_start) {
+    subtitles.emplace_back(start, stop, std::move(text_lines));
+    m_last_start = start;
+  } else {
+    m_held.emplace_back(start, stop, std::move(text_lines));
+  }
+}
+
+void SubtitleFileReader::Finish(std::vector<Subtitle>& subtitles)
+{
+  if (!m_held.empty()) {
+    for (auto& sub : m_held)
+      subtitles.push_back(std::move(sub));
+    m_held.clear();
+
+    std::stable_sort(subtitles.begin(), subtitles.end(),
+      [](const Subtitle& a, const Subtitle& b) { return a.start < b.start; });
+
+    m_reordered = true;
+  }
+
+  double ms = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - m_open_time).count();
+  CLog::Log(LOGINFO, "SubtitleFileReader: %zu cues from %s (%.1fKB) in %.1fms%s",
+    m_cues, m_filename.c_str(), m_size / 1024.0, ms, m_reordered ? ", sorted" : "");
+
+  Close();
 }
@@ -28,7 +28,52 @@
 
 #include <string>
 #include <vector>
+#include <chrono>
 
 #include "Subtitle.h"
 
-bool ReadSrt(const std::string& filename, std::vector<Subtitle>& subtitles);
+// Reads SRT, WebVTT and ASS/SSA dialogue from a memory mapped file, a
+// chunk of cues at a time.
+class SubtitleFileReader {
+public:
+  SubtitleFileReader(const SubtitleFileReader&) = delete;
+  SubtitleFileReader& operator=(const SubtitleFileReader&) = delete;
+  SubtitleFileReader();
+  ~SubtitleFileReader();
+
+  bool Open(const std::string& filename);
+  void Close();
+
+  // Appends up to max_cues cues to subtitles, returns false once the whole
+  // file has been read. Cues are appended as long as the file is in order;
+  // after that they are held back and everything is sorted at the end.
+  bool Read(std::vector<Subtitle>& subtitles, size_t max_cues);
+
+  // True if the last Read sorted subtitles, so earlier indexes are stale
+  bool Reordered() { return m_reordered; }
+
+private:
+  enum Format { SRT, ASS };
+
+  bool NextLine(const char*& line, const char*& line_end);
+  bool ReadCue(std::vector<Subtitle>& subtitles);
+  bool ReadDialogue(std::vector<Subtitle>& subtitles);
+  void Add(std::vector<Subtitle>& subtitles, int start, int stop,
+           std::vector<std::string>& text_lines);
+  void Finish(std::vector<Subtitle>& subtitles);
+
+  std::string m_filename;
+  const char* m_data;
+  size_t m_size;
+  const char* m_pos;
+  Format m_format;
+  bool m_in_events;
+  int m_start_field;
+  int m_end_field;
+  int m_text_field;
+  int m_last_start;
+  bool m_reordered;
+  std::vector<Subtitle> m_held;
+  size_t m_cues;
+  std::chrono::steady_clock::time_point m_open_time;
+};
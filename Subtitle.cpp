@@ -19,103 +19,71 @@
 
 #include <vector>
 #include <string>
-#include <iostream>
+#include <string.h>
 
 #include "Subtitle.h"
-#include "utils/simple_geometry.h"
 
 using namespace std;
 
-Subtitle::Subtitle(bool is_image)
-: isImage(is_image)
+Subtitle::Subtitle(int start, int stop, vector<string> &&text_lines)
+: start(start),
+  stop(stop),
+  isImage(false),
+  m_text_lines(make_shared<const vector<string>>(move(text_lines)))
 {
-  if(isImage) {
-    new(&image.data) basic_string<unsigned char>();
-  } else {
-    new(&text_lines) vector<string>();
-  }
 }
 
-Subtitle::Subtitle(int start, int stop, vector<string> &tl)
+Subtitle::Subtitle(int start, int stop, Image &&image)
 : start(start),
-  stop(stop)
+  stop(stop),
+  isImage(true),
+  m_image(make_shared<const Image>(move(image)))
 {
-  isImage = false;
-  new(&text_lines) vector<string>();
-  text_lines = move(tl);
 }
 
-Subtitle::Subtitle(const Subtitle &old) //copy
+void Subtitle::Image::encode(const unsigned char *pixels, int stride)
 {
-  start = old.start;
-  stop = old.stop;
-  isImage = old.isImage;
+  rle.clear();
 
-  if(isImage) {
-    new(&image.data) basic_string<unsigned char>();
-    image.data = old.image.data;
-    image.rect = old.image.rect;
-  } else {
-    new(&text_lines) vector<string>();
-    text_lines = old.text_lines;
-  }
-}
+  for(int y = 0; y < rect.height; y++) {
+    const unsigned char *p = pixels + y * stride;
+    const unsigned char *end = p + rect.width;
 
-Subtitle& Subtitle::operator=(const Subtitle &old) // copy assign
-{
-  start = old.start;
-  stop = old.stop;
-  isImage = old.isImage;
+    while(p < end) {
+      unsigned char index = *p;
+      int count = 1;
+      while(p + count < end && count < 255 && p[count] == index)
+        count++;
 
-  if(isImage) {
-    new(&image.data) basic_string<unsigned char>();
-    image.data = old.image.data;
-    image.rect = old.image.rect;
-  } else {
-    new(&text_lines) vector<string>();
-    text_lines = old.text_lines;
+      rle.push_back(count);
+      rle.push_back(index);
+      p += count;
+    }
   }
-  return *this;
 }
 
-Subtitle::Subtitle(Subtitle &&old) noexcept //move
+void Subtitle::Image::decode(unsigned char *dst, int pitch) const
 {
-  start = old.start;
-  stop = old.stop;
-  isImage = old.isImage;
+  const unsigned char *run = rle.data();
+  const unsigned char *runs_end = run + rle.size();
 
-  if(isImage) {
-    new(&image.data) basic_string<unsigned char>();
-    image.data = move(old.image.data);
-    image.rect = move(old.image.rect);
-  } else {
-    new(&text_lines) vector<string>();
-    text_lines = move(old.text_lines);
+  for(int y = 0; y < rect.height; y++) {
+    unsigned char *p = dst + y * pitch;
+    unsigned char *end = p + rect.width;
+
+    for(; p < end && run < runs_end; run += 2) {
+      memset(p, run[1], run[0]);
+      p += run[0];
+    }
   }
 }
 
-Subtitle& Subtitle::operator=(Subtitle &&old) noexcept // move assign
+const vector<string> &Subtitle::text_lines() const
 {
-  start = old.start;
-  stop = old.stop;
-  isImage = old.isImage;
-
-  if(isImage) {
-    new(&image.data) basic_string<unsigned char>();
-    image.data = move(old.image.data);
-    image.rect = move(old.image.rect);
-  } else {
-    new(&text_lines) vector<string>();
-    text_lines = move(old.text_lines);
-  }
-  return *this;
+  return *m_text_lines;
 }
 
-Subtitle::~Subtitle()
+const Subtitle::Image &Subtitle::image() const
 {
-  if(isImage) {
-    image.data.~basic_string<unsigned char>();
-  } else {
-    text_lines.~vector<string>();
-  }
+  return *m_image;
 }
@@ -20,32 +20,36 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 #include "utils/simple_geometry.h"
 
+// A cue with its text or bitmap. The payload is shared and never changes
+// after construction, so copying a subtitle only bumps a reference count.
 class Subtitle {
   public:
-  Subtitle(bool is_image);
-
-  Subtitle(int start, int stop, std::vector<std::string> &text_lines);
-
-  Subtitle(const Subtitle &old);
-  Subtitle& operator=(const Subtitle &old);
-
-  Subtitle(Subtitle &&old) noexcept;
-  Subtitle& operator=(Subtitle &&old) noexcept;
+  // An 8-bit indexed bitmap, run length encoded as (count, index) byte
+  // pairs. Runs never cross rows.
+  struct Image {
+    std::basic_string<unsigned char> rle;
+    Rectangle rect;
+
+    void encode(const unsigned char *pixels, int stride);
+    // Decodes rect.height rows of rect.width pixels, pitch bytes apart
+    void decode(unsigned char *dst, int pitch) const;
+  };
 
-  ~Subtitle();
+  Subtitle(int start, int stop, std::vector<std::string> &&text_lines);
+  Subtitle(int start, int stop, Image &&image);
 
   int start;
   int stop;
   bool isImage = false;
 
-  union {
-    std::vector<std::string> text_lines;
-    struct {
-      std::basic_string<unsigned char> data;
-      Rectangle rect;
-    } image;
-  };
+  const std::vector<std::string> &text_lines() const;
+  const Image &image() const;
+
+  private:
+  std::shared_ptr<const std::vector<std::string>> m_text_lines;
+  std::shared_ptr<const Image> m_image;
 };
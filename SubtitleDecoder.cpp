@@ -0,0 +1,126 @@
+#include "SubtitleDecoder.h"
+#include "utils/log.h"
+#include "utils/LockBlock.h"
+#include "utils/ScopeExit.h"
+
+#include <chrono>
+
+using namespace std;
+
+SubtitleDecoder::SubtitleDecoder(Callback callback)
+: m_callback(std::move(callback)),
+  m_codec_context(),
+  m_generation(),
+  m_decoded(),
+  m_decode_time()
+{}
+
+SubtitleDecoder::~SubtitleDecoder()
+{
+  if(Running())
+    Stop();
+
+  if(m_codec_context)
+  {
+    avcodec_free_context(&m_codec_context);
+    CLog::Log(LOGINFO, "SubtitleDecoder: %u bitmaps decoded in %.1fms",
+              m_decoded, m_decode_time);
+  }
+}
+
+bool SubtitleDecoder::Open()
+{
+  AVCodec *dvd_codec = m_dllAvCodec.avcodec_find_decoder(AV_CODEC_ID_DVD_SUBTITLE);
+  m_codec_context = m_dllAvCodec.avcodec_alloc_context3(dvd_codec);
+  if(!m_codec_context ||
+     m_dllAvCodec.avcodec_open2(m_codec_context, dvd_codec, NULL) < 0)
+  {
+    CLog::Log(LOGERROR, "SubtitleDecoder::Open - could not open the DVD subtitle decoder");
+    return false;
+  }
+
+  return Create();
+}
+
+void SubtitleDecoder::Stop()
+{
+  LOCK_BLOCK(m_jobs_lock)
+    m_bStop = true;
+  m_jobs_cond.notify_all();
+  StopThread();
+}
+
+void SubtitleDecoder::Add(OMXPacket *pkt, size_t stream_index)
+{
+  LOCK_BLOCK(m_jobs_lock)
+    m_jobs.push_back(Job{m_generation, stream_index, unique_ptr<OMXPacket>(pkt)});
+  m_jobs_cond.notify_one();
+}
+
+void SubtitleDecoder::Flush()
+{
+  // Waits for a subtitle being handed over, so none gets through after this
+  LOCK_BLOCK(m_jobs_lock)
+  {
+    m_generation++;
+    m_jobs.clear();
+  }
+}
+
+bool SubtitleDecoder::Decode(OMXPacket *pkt, Subtitle::Image &image, int &duration)
+{
+  AVSubtitle s;
+  int got_sub_ptr = -1;
+  m_dllAvCodec.avcodec_decode_subtitle2(m_codec_context, &s, &got_sub_ptr, pkt);
+
+  if(got_sub_ptr < 1) return false;
+
+  SCOPE_EXIT
+  {
+    avsubtitle_free(&s);
+  };
+
+  if(s.num_rects < 1) return false;
+
+  // Fix time
+  duration = s.end_display_time - s.start_display_time;
+
+  // Subpictures are mostly transparent, they are kept run length encoded
+  image.rect = {s.rects[0]->x, s.rects[0]->y, s.rects[0]->w, s.rects[0]->h};
+  image.encode(s.rects[0]->pict.data[0], s.rects[0]->pict.linesize[0]);
+
+  return true;
+}
+
+void SubtitleDecoder::Process()
+{
+  unique_lock<mutex> lock(m_jobs_lock);
+  for(;;)
+  {
+    m_jobs_cond.wait(lock, [&]{ return m_bStop || !m_jobs.empty(); });
+    if(m_bStop)
+      break;
+
+    Job job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+
+    lock.unlock();
+    auto begin = chrono::steady_clock::now();
+
+    int start = static_cast<int>(job.pkt->pts/1000);
+    int duration = static_cast<int>(job.pkt->duration/1000);
+    Subtitle::Image image;
+    bool decoded = Decode(job.pkt.get(), image, duration);
+    job.pkt.reset();
+
+    m_decode_time += chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+    lock.lock();
+
+    if(!decoded)
+      continue;
+    m_decoded++;
+
+    if(job.generation == m_generation)
+      m_callback(job.stream_index, Subtitle(start, start + duration, std::move(image)));
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "OMXThread.h"
+#include "OMXReader.h"
+#include "Subtitle.h"
+#include "DllAvCodec.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Decodes DVD subtitle packets on its own thread, so that the demux loop
+// only has to queue them. Decoded subtitles are handed to the callback on
+// that thread, unless a flush came in since their packet was queued.
+class SubtitleDecoder : public OMXThread
+{
+public:
+  typedef std::function<void(size_t stream_index, Subtitle&& sub)> Callback;
+
+  SubtitleDecoder(const SubtitleDecoder&) = delete;
+  SubtitleDecoder& operator=(const SubtitleDecoder&) = delete;
+  SubtitleDecoder(Callback callback);
+  ~SubtitleDecoder();
+
+  bool Open();
+  // Takes ownership of pkt
+  void Add(OMXPacket *pkt, size_t stream_index);
+  // Drops the queued packets, and the one being decoded once it's done
+  void Flush();
+
+private:
+  struct Job
+  {
+    unsigned int generation;
+    size_t stream_index;
+    std::unique_ptr<OMXPacket> pkt;
+  };
+
+  void Process();
+  void Stop();
+  bool Decode(OMXPacket *pkt, Subtitle::Image &image, int &duration);
+
+  Callback                m_callback;
+  DllAvCodec              m_dllAvCodec;
+  AVCodecContext         *m_codec_context;
+  std::mutex              m_jobs_lock;
+  std::condition_variable m_jobs_cond;
+  std::deque<Job>         m_jobs;
+  unsigned int            m_generation;
+  unsigned int            m_decoded;
+  double                  m_decode_time;
+};
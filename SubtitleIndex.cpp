@@ -0,0 +1,81 @@
+#include "SubtitleIndex.h"
+
+#include <algorithm>
+#include <climits>
+
+SubtitleIndex::SubtitleIndex()
+: m_leaves()
+{}
+
+void SubtitleIndex::Clear()
+{
+  m_starts.clear();
+  m_max_stop.clear();
+  m_leaves = 0;
+}
+
+void SubtitleIndex::Assign(const std::vector<Subtitle>& subtitles)
+{
+  Clear();
+  for(auto& sub : subtitles)
+    Append(sub);
+}
+
+// Doubles the leaves and rebuilds the inner nodes from them
+void SubtitleIndex::Grow()
+{
+  size_t leaves = m_leaves ? m_leaves * 2 : 64;
+  std::vector<int> max_stop(2 * leaves, INT_MIN);
+
+  std::copy(m_max_stop.begin() + m_leaves, m_max_stop.begin() + m_leaves + m_starts.size(),
+            max_stop.begin() + leaves);
+  for(size_t node = leaves - 1; node > 0; node--)
+    max_stop[node] = std::max(max_stop[2 * node], max_stop[2 * node + 1]);
+
+  m_max_stop.swap(max_stop);
+  m_leaves = leaves;
+}
+
+void SubtitleIndex::Append(const Subtitle& sub)
+{
+  if(m_starts.size() == m_leaves)
+    Grow();
+
+  size_t node = m_leaves + m_starts.size();
+  m_starts.push_back(sub.start);
+  m_max_stop[node] = sub.stop;
+  for(node /= 2; node > 0 && m_max_stop[node] < sub.stop; node /= 2)
+    m_max_stop[node] = sub.stop;
+}
+
+size_t SubtitleIndex::UpperBound(int time) const
+{
+  return std::upper_bound(m_starts.begin(), m_starts.end(), time) - m_starts.begin();
+}
+
+void SubtitleIndex::Find(int time, std::vector<size_t>& found) const
+{
+  found.clear();
+
+  size_t end = UpperBound(time);
+  if(end > 0)
+    Collect(1, 0, m_leaves, end, time, found);
+}
+
+// Walks down the subtrees below end that still have something showing
+void SubtitleIndex::Collect(size_t node, size_t node_begin, size_t node_end,
+                            size_t end, int time, std::vector<size_t>& found) const
+{
+  if(node_begin >= end || m_max_stop[node] <= time)
+    return;
+
+  if(node >= m_leaves)
+  {
+    found.push_back(node - m_leaves);
+    return;
+  }
+
+  size_t mid = (node_begin + node_end) / 2;
+  Collect(2 * node, node_begin, mid, end, time, found);
+  Collect(2 * node + 1, mid, node_end, end, time, found);
+}
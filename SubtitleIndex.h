@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "Subtitle.h"
+
+// Finds the subtitles showing at a given time, when they may overlap.
+// Subtitles are kept in order of start time, and an implicit binary tree
+// over them holds the latest stop time of each subtree, so a lookup costs
+// O(log n) per subtitle found.
+class SubtitleIndex
+{
+public:
+  SubtitleIndex();
+
+  void Clear();
+  void Assign(const std::vector<Subtitle>& subtitles);
+  // sub must not start before the last one added
+  void Append(const Subtitle& sub);
+
+  size_t Size() const
+  {
+    return m_starts.size();
+  }
+
+  // Indexes of the subtitles with start <= time < stop, in start order
+  void Find(int time, std::vector<size_t>& found) const;
+  // Index of the first subtitle starting after time
+  size_t UpperBound(int time) const;
+
+private:
+  void Grow();
+  void Collect(size_t node, size_t node_begin, size_t node_end,
+               size_t end, int time, std::vector<size_t>& found) const;
+
+  std::vector<int> m_starts;
+  std::vector<int> m_max_stop;
+  size_t           m_leaves;
+};
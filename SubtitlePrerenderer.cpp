@@ -0,0 +1,129 @@
+#include "SubtitlePrerenderer.h"
+#include "utils/log.h"
+#include "utils/LockBlock.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+SubtitlePrerenderer::SubtitlePrerenderer(SubtitleRenderer& renderer)
+: m_renderer(renderer),
+  m_generation(),
+  m_busy(),
+  m_busy_index(),
+  m_hits(),
+  m_misses()
+{
+  Create();
+}
+
+SubtitlePrerenderer::~SubtitlePrerenderer()
+{
+  if(Running())
+    Stop();
+  ReleaseDone();
+}
+
+void SubtitlePrerenderer::Stop()
+{
+  LOCK_BLOCK(m_jobs_lock)
+    m_bStop = true;
+  m_jobs_cond.notify_all();
+  StopThread();
+}
+
+void SubtitlePrerenderer::ReleaseDone()
+{
+  for(auto& done : m_done)
+    m_renderer.release(done.image);
+  m_done.clear();
+}
+
+void SubtitlePrerenderer::Request(size_t index, const vector<size_t>& cues, const Subtitle& sub)
+{
+  LOCK_BLOCK(m_jobs_lock)
+    m_jobs.push_back(Job{m_generation, index, cues, sub});
+  m_jobs_cond.notify_one();
+}
+
+bool SubtitlePrerenderer::Take(size_t index, const vector<size_t>& cues, SubtitleRenderer::Image& image)
+{
+  unique_lock<mutex> lock(m_jobs_lock);
+
+  // Waiting for a subtitle already being drawn beats drawing it again
+  m_jobs_cond.wait(lock, [&]{ return !m_busy || m_busy_index != index; });
+
+  while(!m_done.empty() && m_done.front().index < index)
+  {
+    m_renderer.release(m_done.front().image);
+    m_done.pop_front();
+  }
+  while(!m_jobs.empty() && m_jobs.front().index <= index)
+    m_jobs.pop_front();
+
+  if(!m_done.empty() && m_done.front().index == index)
+  {
+    Done done = std::move(m_done.front());
+    m_done.pop_front();
+    // something ended or started in between, the stack is different
+    if(done.cues == cues)
+    {
+      image = done.image;
+      m_hits++;
+      return true;
+    }
+    m_renderer.release(done.image);
+  }
+
+  m_misses++;
+  return false;
+}
+
+void SubtitlePrerenderer::Invalidate()
+{
+  LOCK_BLOCK(m_jobs_lock)
+  {
+    m_generation++;
+    m_jobs.clear();
+    ReleaseDone();
+    // the job in hand is thrown away when it's done
+    m_busy = false;
+  }
+}
+
+void SubtitlePrerenderer::Process()
+{
+  // Stay out of the way of the render loop and the players
+  if(setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10) < 0)
+    CLog::Log(LOGWARNING, "SubtitlePrerenderer: could not lower thread priority");
+
+  unique_lock<mutex> lock(m_jobs_lock);
+  for(;;)
+  {
+    m_jobs_cond.wait(lock, [&]{ return m_bStop || !m_jobs.empty(); });
+    if(m_bStop)
+      break;
+
+    Job job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    m_busy = true;
+    m_busy_index = job.index;
+
+    lock.unlock();
+    SubtitleRenderer::Image image = m_renderer.render(job.sub.text_lines());
+    lock.lock();
+
+    if(job.generation == m_generation)
+    {
+      m_busy = false;
+      m_done.push_back(Done{job.index, std::move(job.cues), image});
+    }
+    else
+    {
+      m_renderer.release(image);
+    }
+    m_jobs_cond.notify_all();
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "OMXThread.h"
+#include "SubtitleRenderer.h"
+#include "Subtitle.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Draws upcoming text subtitles on a low priority thread, so that they are
+// ready by the time the render loop has to show them. Images are asked for
+// by the index of the subtitle whose start brings them up, in increasing
+// order, along with the indexes of all the subtitles stacked in them.
+class SubtitlePrerenderer : public OMXThread
+{
+public:
+  SubtitlePrerenderer(const SubtitlePrerenderer&) = delete;
+  SubtitlePrerenderer& operator=(const SubtitlePrerenderer&) = delete;
+  SubtitlePrerenderer(SubtitleRenderer& renderer);
+  ~SubtitlePrerenderer();
+
+  void Request(size_t index, const std::vector<size_t>& cues, const Subtitle& sub);
+  // Hands over the image for index and cues if it is drawn or being drawn
+  bool Take(size_t index, const std::vector<size_t>& cues, SubtitleRenderer::Image& image);
+  // Drops everything requested so far, after a seek or a change of subtitles
+  void Invalidate();
+
+  unsigned int GetHits() { return m_hits; }
+  unsigned int GetMisses() { return m_misses; }
+
+private:
+  struct Job
+  {
+    unsigned int generation;
+    size_t index;
+    std::vector<size_t> cues;
+    Subtitle sub;
+  };
+  struct Done
+  {
+    size_t index;
+    std::vector<size_t> cues;
+    SubtitleRenderer::Image image;
+  };
+
+  void Process();
+  void Stop();
+  void ReleaseDone();
+
+  SubtitleRenderer&       m_renderer;
+  std::mutex              m_jobs_lock;
+  std::condition_variable m_jobs_cond;
+  std::deque<Job>         m_jobs;
+  std::deque<Done>        m_done;
+  unsigned int            m_generation;
+  bool                    m_busy;
+  size_t                  m_busy_index;
+  unsigned int            m_hits;
+  unsigned int            m_misses;
+};
@@ -21,11 +21,11 @@
 #include <string>
 #include <vector>
 
-#include <boost/algorithm/string.hpp>
 #include <cairo.h>
 
-#include "utils/RegExp.h"
+#include "utils/log.h"
 #include "SubtitleRenderer.h"
+#include "SubtitleTags.h"
 #include "DispmanxLayer.h"
 #include "Subtitle.h"
 
@@ -37,16 +37,6 @@ SubtitleRenderer::SubtitleRenderer(int display_num, int layer_num, float r_font_
   m_ghost_box(box_opacity),
   m_max_lines(lines)
 {
-	// Subtitle tag parser regexes
-	m_tags = new CRegExp(true);
-	m_tags->RegComp("(<[^>]*>|\\{\\\\[^\\}]*\\})");
-
-	m_font_color_html = new CRegExp(true);
-	m_font_color_html->RegComp("color[ \\t]*=[ \\t\"']*#?([a-f0-9]{6})");
-
-	m_font_color_curly = new CRegExp(true);
-	m_font_color_curly->RegComp("^\\{\\\\c&h([a-f0-9]{2})([a-f0-9]{2})([a-f0-9]{2})&\\}$");
-
 	// Open display
 	DispmanxLayer::openDisplay(display_num, layer_num);
 
@@ -164,25 +154,74 @@ void SubtitleRenderer::initDVDSubs(Dimension video, float video_aspect_ratio,
 	dvdSubLayer = new DispmanxLayer(1, view_port, video);
 }
 
-void SubtitleRenderer::set_font(int new_font_type)
+cairo_scaled_font_t *SubtitleRenderer::get_scaled_font(int font_type)
 {
-	if(new_font_type == m_current_font) return;
-
-	switch(new_font_type) {
-		case NORMAL_FONT:
-			cairo_set_scaled_font(m_cr, m_normal_font_scaled);
-			break;
+	switch(font_type) {
 		case BOLD_FONT:
-			cairo_set_scaled_font(m_cr, m_bold_font_scaled);
-			break;
+			return m_bold_font_scaled;
 		case ITALIC_FONT:
-			cairo_set_scaled_font(m_cr, m_italic_font_scaled);
-			break;
+			return m_italic_font_scaled;
+		default:
+			return m_normal_font_scaled;
 	}
+}
+
+void SubtitleRenderer::set_font(int new_font_type)
+{
+	if(new_font_type == m_current_font) return;
+
+	cairo_set_scaled_font(m_cr, get_scaled_font(new_font_type));
 
 	m_current_font = new_font_type;
 }
 
+// Subtitles and the OSD repeat the same runs a lot, so shaping is cached
+const SubtitleRenderer::GlyphRun *SubtitleRenderer::shape_text(const string &text, int font_type)
+{
+	string key = to_string(font_type) + ':' + to_string(m_font_size) + ':' + text;
+
+	auto it = m_glyph_index.find(key);
+	if(it != m_glyph_index.end()) {
+		m_glyph_cache.splice(m_glyph_cache.begin(), m_glyph_cache, it->second);
+		m_glyph_hits++;
+		return &m_glyph_cache.front();
+	}
+	m_glyph_misses++;
+
+	cairo_scaled_font_t *font = get_scaled_font(font_type);
+	cairo_glyph_t *glyphs = NULL;
+	int num_glyphs = 0;
+
+	cairo_status_t status = cairo_scaled_font_text_to_glyphs(font, 0, 0,
+			text.c_str(), -1, &glyphs, &num_glyphs, NULL, NULL, NULL);
+
+	if (status != CAIRO_STATUS_SUCCESS)
+		return NULL;
+
+	cairo_text_extents_t extents;
+	cairo_scaled_font_glyph_extents(font, glyphs, num_glyphs, &extents);
+
+	if(m_glyph_cache.size() >= GLYPH_CACHE_SIZE) {
+		m_glyph_index.erase(m_glyph_cache.back().key);
+		m_glyph_cache.pop_back();
+	}
+
+	m_glyph_cache.push_front(GlyphRun{key, vector<cairo_glyph_t>(glyphs, glyphs + num_glyphs), extents.x_advance});
+	m_glyph_index[key] = m_glyph_cache.begin();
+	cairo_glyph_free(glyphs);
+
+	return &m_glyph_cache.front();
+}
+
+void SubtitleRenderer::count_prepare(chrono::steady_clock::time_point start)
+{
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	m_prepared++;
+	m_prepare_total += ms;
+	if(ms > m_prepare_max) m_prepare_max = ms;
+}
+
 void SubtitleRenderer::set_color(int new_color)
 {
 	if(new_color == m_color) return;
@@ -205,86 +244,133 @@ void SubtitleRenderer::set_color(int new_color)
 }
 
 
-void SubtitleRenderer::prepare(Subtitle &sub)
+void SubtitleRenderer::prepare(const Subtitle &sub)
 {
 	unprepare();
 
 	if(sub.isImage)
-		make_subtitle_image(sub);
+		m_next = make_subtitle_image(sub);
 	else
-		parse_lines(sub.text_lines);
+		m_next = render(sub.text_lines());
 }
 
-void SubtitleRenderer::prepare(vector<string> &lines)
+void SubtitleRenderer::prepare(const vector<string> &lines)
 {
-    unprepare();
+	unprepare();
 
-    parse_lines(lines);
+	m_next = render(lines);
 }
 
-void SubtitleRenderer::make_subtitle_image(vector<vector<SubtitleText> > &parsed_lines)
+// takes over an image drawn earlier with render()
+void SubtitleRenderer::prepare(Image &image)
 {
-	// create surface
-	m_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, subtitleLayer->getSourceWidth(), subtitleLayer->getSourceHeight());
-	m_cr = cairo_create(m_surface);
+	unprepare();
 
-	// Reset font control vars as no font or drawing dolour has been set
-	m_current_font = -500;
-	m_color = -500;
+	m_next = image;
+	image = Image();
+}
 
-	// cursor y position
-	int cursor_y_position = subtitleLayer->getSourceHeight() - m_padding;
+SubtitleRenderer::Image SubtitleRenderer::render(const vector<string> &lines)
+{
+	lock_guard<mutex> lock(m_render_lock);
+	auto start = chrono::steady_clock::now();
+
+	Image image = parse_lines(lines);
+
+	count_prepare(start);
+	return image;
+}
+
+void SubtitleRenderer::release(Image &image)
+{
+	if(image.type == Image::DVD)
+		free(image.data);
+	else if(image.type == Image::TEXT)
+		release_buffer(image.data);
+
+	image = Image();
+}
+
+SubtitleRenderer::Image SubtitleRenderer::make_subtitle_image(vector<vector<SubtitleText> > &parsed_lines)
+{
+	Image image;
 
 	// Limit the number of line
 	int no_of_lines = parsed_lines.size();
 	if(no_of_lines > m_max_lines) no_of_lines = m_max_lines;
 
-	for(int i = no_of_lines - 1; i > -1; i--) {
+	// Shape the text first, the surface only has to cover its block
+	vector<int> box_widths(no_of_lines);
+	int block_width = 0;
+
+	for(int i = 0; i < no_of_lines; i++) {
 		int box_width = (m_padding * 2);
-		int text_parts = parsed_lines[i].size();
 
 		// cursor x position
 		int cursor_x_position = 0;
 
-		for(int j = 0; j < text_parts; j++) {
-			set_font(parsed_lines[i][j].font);
-
+		for(SubtitleText &part : parsed_lines[i]) {
 			// prepare font glyphs
-			cairo_status_t status = cairo_scaled_font_text_to_glyphs(
-					cairo_get_scaled_font(m_cr),
-					cursor_x_position + m_padding,
-					cursor_y_position - (m_padding / 4),
-					parsed_lines[i][j].text.c_str(), -1,
-					&parsed_lines[i][j].glyphs,
-					&parsed_lines[i][j].num_glyphs,
-					NULL, NULL, NULL);
-
-			if (status != CAIRO_STATUS_SUCCESS)
-				return;
-
-			// calculate font extents
-			cairo_text_extents_t extents;
-			cairo_glyph_extents (m_cr,
-				parsed_lines[i][j].glyphs,
-				parsed_lines[i][j].num_glyphs,
-				&extents);
-
-			cursor_x_position += extents.x_advance;
-			box_width += extents.x_advance;
+			const GlyphRun *run = shape_text(part.text, part.font);
+			if(!run)
+				return image;
+
+			// move the run to the cursor
+			part.glyphs = run->glyphs;
+			for(cairo_glyph_t &glyph : part.glyphs) {
+				glyph.x += cursor_x_position + m_padding;
+			}
+
+			cursor_x_position += run->x_advance;
+			box_width += run->x_advance;
 		}
 
+		box_widths[i] = box_width;
+		if(box_width > block_width) block_width = box_width;
+	}
+
+	// Text block within the layer, bottom aligned. The outline and
+	// accents may reach a little past the boxes.
+	int layer_width = subtitleLayer->getSourceWidth();
+	int layer_height = subtitleLayer->getSourceHeight();
+	image.rect.width = min(block_width + 2, layer_width);
+	image.rect.height = min(no_of_lines * (m_font_size + m_padding) + m_padding, layer_height);
+	image.rect.x = m_centered ? (layer_width - image.rect.width) / 2 : 0;
+	image.rect.y = layer_height - image.rect.height;
+
+	// create surface
+	image.type = Image::TEXT;
+	image.data = acquire_buffer();
+	cairo_surface_t *surface = cairo_image_surface_create_for_data(image.data, CAIRO_FORMAT_ARGB32,
+		image.rect.width, image.rect.height, subtitleLayer->getPitch());
+	m_cr = cairo_create(surface);
+
+	// pooled buffers still hold an earlier subtitle
+	cairo_set_operator(m_cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint(m_cr);
+	cairo_set_operator(m_cr, CAIRO_OPERATOR_OVER);
+
+	// Reset font control vars as no font or drawing dolour has been set
+	m_current_font = -500;
+	m_color = -500;
+
+	// cursor y position
+	int cursor_y_position = image.rect.height - m_padding;
+
+	for(int i = no_of_lines - 1; i > -1; i--) {
+		int box_width = box_widths[i];
+		int text_parts = parsed_lines[i].size();
+
 		// aligned text
-		if(m_centered) {
-			cursor_x_position = (subtitleLayer->getSourceWidth() / 2) - (box_width / 2);
-
-			for(int j = 0; j < text_parts; j++) {
-				cairo_glyph_t *p = parsed_lines[i][j].glyphs;
-				for(int h = 0; h < parsed_lines[i][j].num_glyphs; h++, p++) {
-					p->x +=cursor_x_position;
-				}
+		int cursor_x_position = 0;
+		if(m_centered)
+			cursor_x_position = (image.rect.width / 2) - (box_width / 2);
+
+		for(int j = 0; j < text_parts; j++) {
+			for(cairo_glyph_t &glyph : parsed_lines[i][j].glyphs) {
+				glyph.x += cursor_x_position;
+				glyph.y += cursor_y_position - (m_padding / 4);
 			}
-		} else {
-			cursor_x_position = 0;
 		}
 
 		// draw ghost box
@@ -300,10 +386,7 @@ void SubtitleRenderer::make_subtitle_image(vector<vector<SubtitleText> > &parsed
 			set_color(parsed_lines[i][j].color);
 
 			// draw text
-			cairo_glyph_path(m_cr, parsed_lines[i][j].glyphs, parsed_lines[i][j].num_glyphs);
-
-			// free glyph array
-			cairo_glyph_free(parsed_lines[i][j].glyphs);
+			cairo_glyph_path(m_cr, parsed_lines[i][j].glyphs.data(), parsed_lines[i][j].glyphs.size());
 		}
 
 		// draw black text outline
@@ -316,60 +399,67 @@ void SubtitleRenderer::make_subtitle_image(vector<vector<SubtitleText> > &parsed
 		cursor_y_position -= m_font_size + m_padding;
 	}
 
-	cairo_image_data = cairo_image_surface_get_data(m_surface);
-	m_prepared_from_text = true;
-}
+	cairo_surface_flush(surface);
+	cairo_destroy(m_cr);
+	cairo_surface_destroy(surface);
 
+	m_bytes_touched += image.rect.width * 4 * image.rect.height;
+	return image;
+}
 
-void SubtitleRenderer::make_subtitle_image(Subtitle &sub)
+// Text images are drawn into buffers sized for the whole layer, kept for reuse
+unsigned char *SubtitleRenderer::acquire_buffer()
 {
-	unsigned char *p;
+	lock_guard<mutex> lock(m_pool_lock);
 
-	// Subtitles which exceed dimensions are ignored
-	if(sub.image.rect.x + sub.image.rect.width  > dvdSubLayer->getSourceWidth() || sub.image.rect.y + sub.image.rect.height  > dvdSubLayer->getSourceHeight())
-	  return;
+	if(m_buffer_pool.empty())
+		return (unsigned char *)malloc(subtitleLayer->getPitch() * subtitleLayer->getSourceHeight());
 
-	p = other_image_data = (unsigned char *)malloc(dvdSubLayer->getSourceWidth() * dvdSubLayer->getSourceHeight());
+	unsigned char *buffer = m_buffer_pool.back();
+	m_buffer_pool.pop_back();
+	return buffer;
+}
 
-	auto mem_set = [&p](int num_pixels)
-	{
-		memset(p, '\0', num_pixels);
-		p += num_pixels;
-	};
+void SubtitleRenderer::release_buffer(unsigned char *buffer)
+{
+	lock_guard<mutex> lock(m_pool_lock);
 
-	auto mem_copy = [&p](const unsigned char *pixel, int len)
-	{
-		memcpy(p, pixel, len);
-		p += len;
-	};
+	if(m_buffer_pool.size() < BUFFER_POOL_SIZE)
+		m_buffer_pool.push_back(buffer);
+	else
+		free(buffer);
+}
 
-	int right_padding  = dvdSubLayer->getSourceWidth()  - sub.image.rect.width  - sub.image.rect.x;
-	int bottom_padding = dvdSubLayer->getSourceHeight() - sub.image.rect.height - sub.image.rect.y;
 
-	// blanks char at top
-	mem_set(sub.image.rect.y * dvdSubLayer->getSourceWidth());
+SubtitleRenderer::Image SubtitleRenderer::make_subtitle_image(const Subtitle &sub)
+{
+	const Subtitle::Image &bitmap = sub.image();
+	Image image;
 
-	for(int j = 0; j < sub.image.rect.height; j++) {
-		mem_set(sub.image.rect.x);
-		mem_copy(sub.image.data.data() + (j * sub.image.rect.width), sub.image.rect.width);
-		mem_set(right_padding);
-	}
+	// Subtitles which exceed dimensions are ignored
+	if(bitmap.rect.x + bitmap.rect.width  > dvdSubLayer->getSourceWidth() || bitmap.rect.y + bitmap.rect.height  > dvdSubLayer->getSourceHeight())
+	  return image;
 
-	// blanks char at bottom
-	mem_set(bottom_padding * dvdSubLayer->getSourceWidth());
+	// only the subtitle's own rectangle is decoded and uploaded
+	image.type = Image::DVD;
+	image.rect = bitmap.rect;
+	image.data = (unsigned char *)malloc(dvdSubLayer->getPitch() * bitmap.rect.height);
+	bitmap.decode(image.data, dvdSubLayer->getPitch());
 
-	m_prepared_from_image = true;
+	return image;
 }
 
 void SubtitleRenderer::show_next()
 {
-	if(m_prepared_from_image) {
+	if(m_next.type == Image::DVD) {
 		subtitleLayer->hideElement();
-		dvdSubLayer->setImageData(other_image_data);
+		dvdSubLayer->setImageData(m_next.data, m_next.rect);
 		unprepare();
-	} else if(m_prepared_from_text) {
+	} else if(m_next.type == Image::TEXT) {
 		if(dvdSubLayer) dvdSubLayer->hideElement();
-		subtitleLayer->setImageData(cairo_image_data);
+		subtitleLayer->setImageData(m_next.data, m_next.rect);
+		m_text_images++;
+		m_bytes_uploaded += subtitleLayer->getPitch() * m_next.rect.height;
 		unprepare();
 	}
 }
@@ -388,93 +478,44 @@ void SubtitleRenderer::clear()
 
 void SubtitleRenderer::unprepare()
 {
-	if(m_prepared_from_image) {
-		free(other_image_data);
-		m_prepared_from_image = false;
-	}
-
-	if(m_prepared_from_text) {
-		cairo_destroy(m_cr);
-		cairo_surface_destroy(m_surface);
-		m_prepared_from_text = false;
-	}
+	release(m_next);
 }
 
-// Tag parser functions
-void SubtitleRenderer::parse_lines(vector<string> &text_lines)
+SubtitleRenderer::Image SubtitleRenderer::parse_lines(const vector<string> &text_lines)
 {
 	vector<vector<SubtitleText> > formatted_lines(text_lines.size());
 
-	bool bold = false, italic = false;
-	int color = -1;
+	SubtitleTagState state;
+	vector<SubtitleTextRun> runs;
 
 	for(uint i=0; i < text_lines.size(); i++) {
-		boost::algorithm::trim(text_lines[i]);
-
-		int pos = 0, old_pos = 0;
-
-		int line_length = text_lines[i].length();
-		while (pos < line_length) {
-			pos = m_tags->RegFind(text_lines[i].c_str(), pos);
-
-			//parse text
-			if(pos != old_pos) {
-				string t = text_lines[i].substr(old_pos, pos - old_pos);
-				int font = italic ? ITALIC_FONT : (bold ? BOLD_FONT : NORMAL_FONT);
-				formatted_lines[i].emplace_back(move(t), font, color);
-			}
+		runs.clear();
+		tokenize_subtitle_line(text_lines[i].data(), text_lines[i].length(), state, runs);
 
-			// No more tags found
-			if(pos < 0) break;
-
-			// Parse Tag
-			string fullTag = m_tags->GetMatch(0);
-			boost::algorithm::to_lower(fullTag);
-			pos += fullTag.length();
-			old_pos = pos;
-
-			if (fullTag == "<b>" || fullTag == "{\\b1}") {
-				bold = true;
-			} else if ((fullTag == "</b>" || fullTag == "{\\b0}") && bold) {
-				bold = false;
-			} else if (fullTag == "<i>" || fullTag == "{\\i1}") {
-				italic = true;
-			} else if ((fullTag == "</i>" || fullTag == "{\\i0}") && italic) {
-				italic = false;
-			} else if ((fullTag == "</font>" || fullTag == "{\\c}") && color != -1) {
-				color = -1;
-			} else if (fullTag.substr(0,5) == "<font") {
-				if(m_font_color_html->RegFind(fullTag.c_str(), 5) >= 0) {
-					color = hex2int(m_font_color_html->GetMatch(1).c_str());
-				}
-			} else if(m_font_color_curly->RegFind(fullTag.c_str(), 0) >= 0) {
-				string t = m_font_color_curly->GetMatch(3) + m_font_color_curly->GetMatch(2)
-					+ m_font_color_curly->GetMatch(1);
-				color = hex2int(t.c_str());
-			}
+		for(const SubtitleTextRun &run : runs) {
+			int font = run.italic ? ITALIC_FONT : (run.bold ? BOLD_FONT : NORMAL_FONT);
+			formatted_lines[i].emplace_back(string(run.text, run.length), font, run.color);
 		}
 	}
 
-	make_subtitle_image(formatted_lines);
-}
-
-// expects 6 lowercase, digit hex string
-int SubtitleRenderer::hex2int(const char *hex)
-{
-	int r = 0;
-	for(int i = 0, f = 20; i < 6; i++, f -= 4)
-		if(hex[i] >= 'a')
-			r += (hex[i] - 87) << f;
-		else
-			r += (hex[i] - 48) << f;
-
-	return r;
+	return make_subtitle_image(formatted_lines);
 }
 
 SubtitleRenderer::~SubtitleRenderer()
 {
-	//destroy cairo surface, if defined
+	unsigned int lookups = m_glyph_hits + m_glyph_misses;
+	CLog::Log(LOGINFO, "SubtitleRenderer: glyph cache %u/%u hits (%.0f%%), %u subtitles prepared in %.2fms avg, %.2fms max",
+		m_glyph_hits, lookups, lookups ? 100.0 * m_glyph_hits / lookups : 0.0,
+		m_prepared, m_prepared ? m_prepare_total / m_prepared : 0.0, m_prepare_max);
+	if(m_text_images)
+		CLog::Log(LOGINFO, "SubtitleRenderer: %u text images, %.1fKB drawn and %.1fKB uploaded per image (whole layer %.1fKB)",
+			m_text_images, m_bytes_touched / 1024.0 / m_text_images, m_bytes_uploaded / 1024.0 / m_text_images,
+			subtitleLayer->getPitch() * subtitleLayer->getSourceHeight() / 1024.0);
+
+	//free the prepared image, if any
 	unprepare();
+	for(unsigned char *buffer : m_buffer_pool)
+		free(buffer);
 
 	// remove DispmanX layer
 	delete subtitleLayer;
@@ -485,9 +526,4 @@ SubtitleRenderer::~SubtitleRenderer()
 	cairo_scaled_font_destroy(m_normal_font_scaled);
 	cairo_scaled_font_destroy(m_italic_font_scaled);
 	cairo_scaled_font_destroy(m_bold_font_scaled);
-
-	//delete regexes
-	delete m_tags;
-	delete m_font_color_html;
-	delete m_font_color_curly;
 }
@@ -20,13 +20,16 @@
 
 #include <string>
 #include <vector>
+#include <list>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
 
 #include <cairo.h>
 
 #include "utils/simple_geometry.h"
 #include "Subtitle.h"
 
-class CRegExp;
 class DispmanxLayer;
 using namespace std;
 
@@ -45,13 +48,25 @@ class SubtitleRenderer {
 
 		~SubtitleRenderer();
 
-		void prepare(Subtitle &sub);
-		void prepare(vector<string> &lines);
+		// A drawn subtitle, waiting to be shown
+		struct Image {
+			enum { NONE, TEXT, DVD } type = NONE;
+			unsigned char *data = NULL;
+			Rectangle rect = {0, 0, 0, 0};
+		};
+
+		void prepare(const Subtitle &sub);
+		void prepare(const vector<string> &lines);
+		void prepare(Image &image);
 		void show_next();
 		void hide();
 		void unprepare();
 		void clear();
 
+		// Text images can be drawn from any thread and queued up
+		Image render(const vector<string> &lines);
+		void release(Image &image);
+
 	private:
 		DispmanxLayer *subtitleLayer;
 		DispmanxLayer *dvdSubLayer;
@@ -63,8 +78,7 @@ class SubtitleRenderer {
 				int font;
 				int color;
 
-				cairo_glyph_t *glyphs = NULL;
-				int num_glyphs = -1;
+				vector<cairo_glyph_t> glyphs;
 
 				SubtitleText(string t, int f, int c)
 				: text(t), font(f), color(c)
@@ -72,17 +86,37 @@ class SubtitleRenderer {
 				};
 		};
 
-		void parse_lines(vector<string> &text_lines);
-		void make_subtitle_image(vector<vector<SubtitleText> > &parsed_lines);
-		void make_subtitle_image(Subtitle &sub);
-		int hex2int(const char *hex);
-
-		CRegExp *m_tags;
-		CRegExp *m_font_color_html;
-		CRegExp *m_font_color_curly;
+		Image parse_lines(const vector<string> &text_lines);
+		Image make_subtitle_image(vector<vector<SubtitleText> > &parsed_lines);
+		Image make_subtitle_image(const Subtitle &sub);
 
 		void set_font(int new_font_type);
 		void set_color(int new_color);
+		cairo_scaled_font_t *get_scaled_font(int font_type);
+
+		// Shaped text runs, most recently used first. Glyph positions are
+		// relative to the run origin.
+		struct GlyphRun
+		{
+			string key;
+			vector<cairo_glyph_t> glyphs;
+			double x_advance;
+		};
+		enum { GLYPH_CACHE_SIZE = 256 };
+		list<GlyphRun> m_glyph_cache;
+		unordered_map<string, list<GlyphRun>::iterator> m_glyph_index;
+		const GlyphRun *shape_text(const string &text, int font_type);
+
+		// statistics
+		void count_prepare(chrono::steady_clock::time_point start);
+		unsigned int m_glyph_hits = 0;
+		unsigned int m_glyph_misses = 0;
+		unsigned int m_prepared = 0;
+		double m_prepare_total = 0; // ms
+		double m_prepare_max = 0;
+		unsigned int m_text_images = 0;
+		uint64_t m_bytes_touched = 0;
+		uint64_t m_bytes_uploaded = 0;
 
 		enum {
 			NORMAL_FONT,
@@ -90,13 +124,18 @@ class SubtitleRenderer {
 			BOLD_FONT,
 		};
 
-		bool m_prepared_from_image = false;
-		bool m_prepared_from_text = false;
-		unsigned char *cairo_image_data;
-		unsigned char *other_image_data;
+		Image m_next;
+
+		// guards the cairo context, fonts and glyph cache
+		mutex m_render_lock;
+
+		enum { BUFFER_POOL_SIZE = 6 };
+		mutex m_pool_lock;
+		vector<unsigned char *> m_buffer_pool;
+		unsigned char *acquire_buffer();
+		void release_buffer(unsigned char *buffer);
 
 		// cairo stuff
-		cairo_surface_t *m_surface;
 		cairo_t *m_cr;
 
 		// fonts
@@ -0,0 +1,129 @@
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "SubtitleTags.h"
+
+// Finds the next <...> or {\...} tag from p, sets tag_end past it
+static const char *find_tag(const char *p, const char *end, const char **tag_end)
+{
+	for(; p < end; p++) {
+		const char *close = NULL;
+
+		if(*p == '<')
+			close = (const char *)memchr(p + 1, '>', end - p - 1);
+		else if(*p == '{' && p + 1 < end && p[1] == '\\')
+			close = (const char *)memchr(p + 2, '}', end - p - 2);
+
+		if(close) {
+			*tag_end = close + 1;
+			return p;
+		}
+	}
+	return NULL;
+}
+
+static bool tag_is(const char *tag, size_t len, const char *name)
+{
+	return strlen(name) == len && strncasecmp(tag, name, len) == 0;
+}
+
+// value of the digits hex digits at p, or -1
+static int read_hex(const char *p, const char *end, int digits)
+{
+	if(end - p < digits) return -1;
+
+	int r = 0;
+	for(int i = 0; i < digits; i++) {
+		char c = p[i];
+		r <<= 4;
+		if(c >= '0' && c <= '9')
+			r += c - '0';
+		else if(c >= 'a' && c <= 'f')
+			r += c - 'a' + 10;
+		else if(c >= 'A' && c <= 'F')
+			r += c - 'A' + 10;
+		else
+			return -1;
+	}
+	return r;
+}
+
+// <font ... color = "#rrggbb" ...>
+static int html_color(const char *tag, const char *end)
+{
+	for(const char *p = tag + 5; end - p >= 5; p++) {
+		if(strncasecmp(p, "color", 5) != 0) continue;
+
+		const char *q = p + 5;
+		while(q < end && (*q == ' ' || *q == '\t')) q++;
+		if(q == end || *q != '=') continue;
+		q++;
+		while(q < end && (*q == ' ' || *q == '\t' || *q == '"' || *q == '\'')) q++;
+		if(q < end && *q == '#') q++;
+
+		int color = read_hex(q, end, 6);
+		if(color >= 0) return color;
+	}
+	return -1;
+}
+
+// {\c&Hbbggrr&}
+static int curly_color(const char *tag, size_t len)
+{
+	if(len != 13 || strncasecmp(tag, "{\\c&h", 5) != 0 || tag[11] != '&' || tag[12] != '}')
+		return -1;
+
+	int b = read_hex(tag + 5, tag + 7, 2);
+	int g = read_hex(tag + 7, tag + 9, 2);
+	int r = read_hex(tag + 9, tag + 11, 2);
+	if(b < 0 || g < 0 || r < 0) return -1;
+
+	return (r << 16) | (g << 8) | b;
+}
+
+void tokenize_subtitle_line(const char *line, size_t length,
+		SubtitleTagState &state, std::vector<SubtitleTextRun> &runs)
+{
+	const char *end = line + length;
+
+	// trimmed
+	while(line < end && isspace((unsigned char)*line)) line++;
+	while(end > line && isspace((unsigned char)end[-1])) end--;
+	const char *p = line;
+
+	while (p < end) {
+		const char *tag_end = end;
+		const char *tag = find_tag(p, end, &tag_end);
+		if(!tag) tag = end;
+
+		//parse text
+		if(tag != p)
+			runs.push_back({p, (size_t)(tag - p), state.bold, state.italic, state.color});
+
+		// No more tags found
+		if(tag == end) break;
+
+		// Parse Tag
+		size_t len = tag_end - tag;
+		p = tag_end;
+
+		if (tag_is(tag, len, "<b>") || tag_is(tag, len, "{\\b1}")) {
+			state.bold = true;
+		} else if ((tag_is(tag, len, "</b>") || tag_is(tag, len, "{\\b0}")) && state.bold) {
+			state.bold = false;
+		} else if (tag_is(tag, len, "<i>") || tag_is(tag, len, "{\\i1}")) {
+			state.italic = true;
+		} else if ((tag_is(tag, len, "</i>") || tag_is(tag, len, "{\\i0}")) && state.italic) {
+			state.italic = false;
+		} else if ((tag_is(tag, len, "</font>") || tag_is(tag, len, "{\\c}")) && state.color != -1) {
+			state.color = -1;
+		} else if (len >= 5 && strncasecmp(tag, "<font", 5) == 0) {
+			int c = html_color(tag, tag_end);
+			if(c >= 0) state.color = c;
+		} else {
+			int c = curly_color(tag, len);
+			if(c >= 0) state.color = c;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// Style carried from one tag to the next, and across the lines of a cue
+struct SubtitleTagState
+{
+	bool bold = false;
+	bool italic = false;
+	int color = -1; // 0xrrggbb, -1 for the default
+};
+
+// Text between tags, pointing into the line it came from
+struct SubtitleTextRun
+{
+	const char *text;
+	size_t length;
+	bool bold;
+	bool italic;
+	int color;
+};
+
+// Splits a trimmed line at its <b>, <i>, <font color=...> and {\b1},
+// {\i1}, {\c&Hbbggrr&} style tags, updating state and appending the text
+// runs in between. Tags are matched case-insensitively, unknown and
+// malformed ones are dropped, a stray '<' or '{' without a close is text.
+void tokenize_subtitle_line(const char *line, size_t length,
+		SubtitleTagState &state, std::vector<SubtitleTextRun> &runs);
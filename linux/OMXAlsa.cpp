@@ -12,12 +12,16 @@
  */
 
 #include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <new>
 #include <alsa/asoundlib.h>
 #include <IL/OMX_Core.h>
 #include <IL/OMX_Component.h>
@@ -29,6 +33,8 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+#include <SoftClock.h>
+
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
 
 struct _GOMX_COMMAND;
@@ -289,8 +295,17 @@ static OMX_ERRORTYPE gomx_component_tunnel_request(
 		pTunnelSetup->eSupplier = suppl.eBufferSupplier;
 		CINFO(comp, port, "ComponentTunnnelRequest: %p %d", hTunneledComp, nTunneledPort);
 	} else {
-		CINFO(comp, port, "OUTPUT TUNNEL UNSUPPORTED: %p, %d, %p", hTunneledComp, nTunneledPort, pTunnelSetup);
-		return OMX_ErrorNotImplemented;
+		/* Output ports offer to supply the buffers. The input side
+		 * confirms with OMX_IndexParamCompBufferSupplier. */
+		if (!port->do_buffer) {
+			CINFO(comp, port, "OUTPUT TUNNEL UNSUPPORTED: %p, %d, %p", hTunneledComp, nTunneledPort, pTunnelSetup);
+			return OMX_ErrorNotImplemented;
+		}
+		port->tunnel_comp = hTunneledComp;
+		port->tunnel_port = nTunneledPort;
+		port->tunnel_supplier = true;
+		pTunnelSetup->eSupplier = OMX_BufferSupplyOutput;
+		CINFO(comp, port, "ComponentTunnnelRequest: %p %d (output)", hTunneledComp, nTunneledPort);
 	}
 	return OMX_ErrorNone;
 
@@ -474,8 +489,24 @@ static OMX_ERRORTYPE gomx_empty_this_buffer(OMX_HANDLETYPE hComponent, OMX_BUFFE
 
 static OMX_ERRORTYPE gomx_fill_this_buffer(OMX_HANDLETYPE hComponent, OMX_BUFFERHEADERTYPE* pBuffer)
 {
-	CDEBUG(hComponent, 0, "stub");
-	return OMX_ErrorNotImplemented;
+	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) hComponent;
+	GOMX_PORT *port;
+	OMX_ERRORTYPE r;
+
+	/* Only supplied buffers coming back to a tunneled output port are
+	 * supported; do_buffer gets them for refilling. */
+	if (comp->state == OMX_StateInvalid) return OMX_ErrorInvalidState;
+	if (!(port = gomx_get_port(comp, pBuffer->nOutputPortIndex)))
+		return OMX_ErrorBadPortIndex;
+	if (port->def.eDir != OMX_DirOutput || !port->tunnel_supplier || !port->do_buffer) {
+		CDEBUG(comp, port, "stub");
+		return OMX_ErrorNotImplemented;
+	}
+
+	pthread_mutex_lock(&comp->mutex);
+	r = port->do_buffer(comp, port, pBuffer);
+	pthread_mutex_unlock(&comp->mutex);
+	return r;
 }
 
 static void __gomx_process_mark(GOMX_COMPONENT *comp, OMX_BUFFERHEADERTYPE *hdr)
@@ -756,6 +787,7 @@ static void *gomx_worker(void *ptr)
 		/* FIXME: Rate limit and retry if needed suppplier buffer enqueuing */
 		for (size_t i = 0; i < comp->nports; i++) {
 			port = &comp->ports[i];
+			if (port->def.eDir != OMX_DirInput) continue;
 			while ((hdr = (OMX_BUFFERHEADERTYPE*)gomxq_dequeue(&port->tunnel_supplierq)) != 0) {
 				pthread_mutex_unlock(&comp->mutex);
 				r = OMX_FillThisBuffer(port->tunnel_comp, hdr);
@@ -858,13 +890,29 @@ static void gomx_fini(GOMX_COMPONENT *comp)
 	pthread_cond_destroy(&comp->cond);
 }
 
-/* ALSA Sink OMX Component */
+/* ALSA Sink OMX Component
+ *
+ * The same component also implements the null and wav sinks; only the
+ * output device differs, which is abstracted by OMX_ALSASINK_OPS. */
 
 #define OMXALSA_PORT_AUDIO		0
 #define OMXALSA_PORT_CLOCK		1
 
+struct _OMX_ALSASINK;
+
+typedef struct _OMX_ALSASINK_OPS {
+	const char *name;
+	bool resample;
+	int (*open)(struct _OMX_ALSASINK *, unsigned int *rate);
+	void (*close)(struct _OMX_ALSASINK *);
+	snd_pcm_state_t (*status)(struct _OMX_ALSASINK *, snd_pcm_sframes_t *delay);
+	snd_pcm_sframes_t (*write)(struct _OMX_ALSASINK *, const void *data, snd_pcm_uframes_t frames);
+	void (*drain)(struct _OMX_ALSASINK *);
+} OMX_ALSASINK_OPS;
+
 typedef struct _OMX_ALSASINK {
 	GOMX_COMPONENT gcomp;
+	const OMX_ALSASINK_OPS *ops;
 	GOMX_PORT port_data[2];
 	GOMX_QUEUE playq;
 	pthread_cond_t cond_play;
@@ -875,9 +923,102 @@ typedef struct _OMX_ALSASINK {
 	snd_pcm_format_t pcm_format;
 	snd_pcm_state_t pcm_state;
 	snd_pcm_sframes_t pcm_delay;
+	OMX_BOOL clock_reference;
 	char device_name[16];
+	char *uri;
+
+	/* Output device state */
+	snd_pcm_t *dev;
+	FILE *wav;
+	uint32_t wav_bytes;
+	uint64_t wav_dropped;
+	double null_next;
 } OMX_ALSASINK;
 
+/* Drift compensation
+ *
+ * When the sink is not the clock reference, the ALSA device crystal and
+ * the media clock run freely against each other. The played position
+ * (buffer pts minus the samples still queued in ALSA and the resampler)
+ * is compared against the media clock, and a PI controller turns the
+ * error into a fractional resampler compensation. */
+
+#define OMXALSA_DRIFT_KP		20000.0	/* ppm per second of error */
+#define OMXALSA_DRIFT_KI		200.0	/* ppm per second of error, per second */
+#define OMXALSA_DRIFT_MAX_PPM		1000.0
+#define OMXALSA_DRIFT_MAX_ERROR		0.1	/* seconds, larger errors reset the controller */
+#define OMXALSA_DRIFT_LOG_INTERVAL	10.0	/* seconds */
+
+typedef struct _OMXALSA_DRIFT {
+	double integral;
+	double ppm;
+	double frac;
+	double last_update, last_log;
+	double err_sum, err_max;
+	unsigned int err_count;
+} OMXALSA_DRIFT;
+
+static double omxalsa_monotonic(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void omxalsa_drift_reset(OMXALSA_DRIFT *d)
+{
+	/* Keep the estimated ppm: the crystal offset survives a seek */
+	d->integral = d->ppm / OMXALSA_DRIFT_KI;
+	d->frac = 0;
+	d->last_update = 0;
+}
+
+static void omxalsa_drift_update(GOMX_COMPONENT *comp, OMXALSA_DRIFT *d, double err)
+{
+	double now = omxalsa_monotonic(), dt, integral, ppm;
+
+	if (fabs(err) > OMXALSA_DRIFT_MAX_ERROR) {
+		CDEBUG(comp, 0, "drift error %.1f ms too large, resetting", err * 1000.0);
+		omxalsa_drift_reset(d);
+		return;
+	}
+
+	dt = d->last_update ? now - d->last_update : 0;
+	d->last_update = now;
+	if (!d->last_log) d->last_log = now;
+
+	integral = d->integral + err * dt;
+	ppm = OMXALSA_DRIFT_KP * err + OMXALSA_DRIFT_KI * integral;
+	/* Anti-windup: stop integrating while the output is saturated */
+	if (fabs(ppm) <= OMXALSA_DRIFT_MAX_PPM)
+		d->integral = integral;
+	if (ppm > OMXALSA_DRIFT_MAX_PPM) ppm = OMXALSA_DRIFT_MAX_PPM;
+	if (ppm < -OMXALSA_DRIFT_MAX_PPM) ppm = -OMXALSA_DRIFT_MAX_PPM;
+	d->ppm = ppm;
+
+	d->err_sum += fabs(err);
+	if (fabs(err) > d->err_max) d->err_max = fabs(err);
+	d->err_count++;
+
+	if (now - d->last_log >= OMXALSA_DRIFT_LOG_INTERVAL) {
+		CINFO(comp, 0, "drift %+.1f ppm (estimated %+.1f ppm), error avg %.2f ms, max %.2f ms",
+			d->ppm, OMXALSA_DRIFT_KI * d->integral,
+			d->err_sum * 1000.0 / d->err_count, d->err_max * 1000.0);
+		d->last_log = now;
+		d->err_sum = d->err_max = 0;
+		d->err_count = 0;
+	}
+}
+
+static int omxalsa_drift_delta(OMXALSA_DRIFT *d, int in_len)
+{
+	/* Carry the sub-sample remainder so small ppm values still apply */
+	double want = in_len * d->ppm / 1e6 + d->frac;
+	int delta = (int) want;
+	d->frac = want - delta;
+	return delta;
+}
+
 static OMX_ERRORTYPE omxalsasink_set_parameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nParamIndex, OMX_PTR pComponentParameterStructure)
 {
 	static const struct {
@@ -908,6 +1049,7 @@ static OMX_ERRORTYPE omxalsasink_set_parameter(OMX_HANDLETYPE hComponent, OMX_IN
 	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) hComponent;
 	GOMX_PORT *port;
 	OMX_AUDIO_PARAM_PCMMODETYPE *pmt;
+	OMX_PARAM_CONTENTURITYPE *uri;
 	OMX_ERRORTYPE r;
 	snd_pcm_format_t pcm_format = SND_PCM_FORMAT_UNKNOWN;
 
@@ -939,6 +1081,15 @@ static OMX_ERRORTYPE omxalsasink_set_parameter(OMX_HANDLETYPE hComponent, OMX_IN
 		memcpy(&sink->pcm, pmt, sizeof *pmt);
 		sink->pcm_format = pcm_format;
 		break;
+	case OMX_IndexParamContentURI:
+		if ((r = omx_cast(uri, pComponentParameterStructure))) return r;
+		if (comp->state != OMX_StateLoaded) return OMX_ErrorIncorrectStateOperation;
+		free(sink->uri);
+		sink->uri = strndup((const char *) uri->contentURI,
+			uri->nSize - offsetof(OMX_PARAM_CONTENTURITYPE, contentURI));
+		if (!sink->uri) return OMX_ErrorInsufficientResources;
+		CDEBUG(comp, 0, "OMX_IndexParamContentURI %s", sink->uri);
+		break;
 	default:
 		CINFO(comp, 0, "UNSUPPORTED %x, %p", nParamIndex, pComponentParameterStructure);
 		return OMX_ErrorNotImplemented;
@@ -988,6 +1139,7 @@ static OMX_ERRORTYPE omxalsasink_set_config(OMX_HANDLETYPE hComponent, OMX_INDEX
 	case OMX_IndexConfigBrcmClockReferenceSource:
 		if ((r = omx_cast(bt, pComponentConfigStructure))) return r;
 		CDEBUG(comp, 0, "OMX_IndexConfigBrcmClockReferenceSource %d", bt->bEnabled);
+		sink->clock_reference = bt->bEnabled;
 		break;
 	case OMX_IndexConfigBrcmAudioDestination:
 		if ((r = omx_cast(adest, pComponentConfigStructure))) return r;
@@ -1012,10 +1164,241 @@ static OMX_ERRORTYPE omxalsasink_deinit(OMX_HANDLETYPE hComponent)
 {
 	OMX_ALSASINK *sink = (OMX_ALSASINK *) hComponent;
 	gomx_fini(&sink->gcomp);
+	free(sink->uri);
 	free(sink);
 	return OMX_ErrorNone;
 }
 
+/* ALSA output */
+
+static int omxalsasink_alsa_open(OMX_ALSASINK *sink, unsigned int *rate)
+{
+	snd_pcm_t *dev;
+	snd_pcm_hw_params_t *hwp;
+	snd_pcm_uframes_t buffer_size, period_size, period_size_max;
+	int err;
+
+	err = snd_pcm_open(&sink->dev, sink->device_name, SND_PCM_STREAM_PLAYBACK, 0);
+	if (err < 0) return err;
+	dev = sink->dev;
+
+	buffer_size = *rate / 5;
+	period_size = buffer_size / 4;
+	period_size_max = buffer_size / 3;
+
+	snd_pcm_hw_params_alloca(&hwp);
+	snd_pcm_hw_params_any(dev, hwp);
+	err = snd_pcm_hw_params_set_channels(dev, hwp, sink->pcm.nChannels);
+	if (err) return err;
+	err = snd_pcm_hw_params_set_access(dev, hwp, sink->pcm.bInterleaved ? SND_PCM_ACCESS_RW_INTERLEAVED : SND_PCM_ACCESS_RW_NONINTERLEAVED);
+	if (err) return err;
+	err = snd_pcm_hw_params_set_rate_near(dev, hwp, rate, 0);
+	if (err) return err;
+	err = snd_pcm_hw_params_set_format(dev, hwp, sink->pcm_format);
+	if (err) return err;
+	err = snd_pcm_hw_params_set_period_size_max(dev, hwp, &period_size_max, 0);
+	if (err) return err;
+	err = snd_pcm_hw_params_set_buffer_size_near(dev, hwp, &buffer_size);
+	if (err) return err;
+	err = snd_pcm_hw_params_set_period_size_near(dev, hwp, &period_size, 0);
+	if (err) return err;
+	return snd_pcm_hw_params(dev, hwp);
+}
+
+static void omxalsasink_alsa_close(OMX_ALSASINK *sink)
+{
+	if (sink->dev) snd_pcm_close(sink->dev);
+	sink->dev = 0;
+}
+
+static snd_pcm_state_t omxalsasink_alsa_status(OMX_ALSASINK *sink, snd_pcm_sframes_t *delay)
+{
+	snd_pcm_delay(sink->dev, delay);
+	return snd_pcm_state(sink->dev);
+}
+
+static snd_pcm_sframes_t omxalsasink_alsa_write(OMX_ALSASINK *sink, const void *data, snd_pcm_uframes_t frames)
+{
+	snd_pcm_sframes_t n = snd_pcm_writei(sink->dev, data, frames);
+	if (n < 0) {
+		CINFO(&sink->gcomp, 0, "alsa error: %ld: %s", n, snd_strerror(n));
+		snd_pcm_recover(sink->dev, n, 1);
+		n = 0;
+	}
+	return n;
+}
+
+static void omxalsasink_alsa_drain(OMX_ALSASINK *sink)
+{
+	snd_pcm_drain(sink->dev);
+	snd_pcm_prepare(sink->dev);
+}
+
+static const OMX_ALSASINK_OPS omxalsasink_alsa_ops = {
+	"OMX.alsa.audio_render", true,
+	omxalsasink_alsa_open,
+	omxalsasink_alsa_close,
+	omxalsasink_alsa_status,
+	omxalsasink_alsa_write,
+	omxalsasink_alsa_drain,
+};
+
+/* Null output: discards samples in real time, or as fast as they arrive
+ * when the destination is "fast". */
+
+#define OMXNULL_BUFFER_TIME		0.2	/* seconds, same as the ALSA buffer */
+
+static int omxalsasink_null_open(OMX_ALSASINK *sink, unsigned int *rate)
+{
+	sink->null_next = 0;
+	return 0;
+}
+
+static void omxalsasink_null_close(OMX_ALSASINK *sink)
+{
+}
+
+static snd_pcm_state_t omxalsasink_null_status(OMX_ALSASINK *sink, snd_pcm_sframes_t *delay)
+{
+	double left = sink->null_next - omxalsa_monotonic();
+	if (left <= 0)
+		return SND_PCM_STATE_PREPARED;
+	*delay = left * sink->sample_rate;
+	return SND_PCM_STATE_RUNNING;
+}
+
+static snd_pcm_sframes_t omxalsasink_null_write(OMX_ALSASINK *sink, const void *data, snd_pcm_uframes_t frames)
+{
+	double now, wait;
+
+	if (strcmp(sink->device_name, "fast") == 0)
+		return frames;
+
+	now = omxalsa_monotonic();
+	if (sink->null_next < now) sink->null_next = now;
+	sink->null_next += (double) frames / sink->sample_rate;
+
+	wait = sink->null_next - now - OMXNULL_BUFFER_TIME;
+	if (wait > 0) usleep(wait * 1000000);
+	return frames;
+}
+
+static void omxalsasink_null_drain(OMX_ALSASINK *sink)
+{
+	double wait = sink->null_next - omxalsa_monotonic();
+	if (wait > 0) usleep(wait * 1000000);
+	sink->null_next = 0;
+}
+
+static const OMX_ALSASINK_OPS omxalsasink_null_ops = {
+	"OMX.alsa.null_render", true,
+	omxalsasink_null_open,
+	omxalsasink_null_close,
+	omxalsasink_null_status,
+	omxalsasink_null_write,
+	omxalsasink_null_drain,
+};
+
+/* WAV file output: writes the PCM exactly as received, without
+ * resampling, to the file set with OMX_IndexParamContentURI. The RIFF
+ * sizes are 32 bit, so samples past 4 GiB are dropped rather than
+ * wrapping the sizes in the header. */
+
+#define OMXWAV_MAX_BYTES	(UINT32_MAX - 36)
+
+static void omxalsasink_wav_put(uint8_t *p, uint32_t v, int bytes)
+{
+	for (int i = 0; i < bytes; i++, v >>= 8)
+		p[i] = v & 0xff;
+}
+
+static int omxalsasink_wav_header(OMX_ALSASINK *sink)
+{
+	uint8_t hdr[44];
+	uint32_t block_align = (sink->pcm.nChannels * sink->pcm.nBitPerSample) >> 3;
+	uint32_t format = 1; /* WAVE_FORMAT_PCM */
+
+	if (sink->pcm_format == SND_PCM_FORMAT_A_LAW) format = 6;
+	if (sink->pcm_format == SND_PCM_FORMAT_MU_LAW) format = 7;
+
+	memcpy(hdr, "RIFF", 4);
+	omxalsasink_wav_put(hdr + 4, 36 + sink->wav_bytes, 4);
+	memcpy(hdr + 8, "WAVEfmt ", 8);
+	omxalsasink_wav_put(hdr + 16, 16, 4);
+	omxalsasink_wav_put(hdr + 20, format, 2);
+	omxalsasink_wav_put(hdr + 22, sink->pcm.nChannels, 2);
+	omxalsasink_wav_put(hdr + 24, sink->pcm.nSamplingRate, 4);
+	omxalsasink_wav_put(hdr + 28, sink->pcm.nSamplingRate * block_align, 4);
+	omxalsasink_wav_put(hdr + 32, block_align, 2);
+	omxalsasink_wav_put(hdr + 34, sink->pcm.nBitPerSample, 2);
+	memcpy(hdr + 36, "data", 4);
+	omxalsasink_wav_put(hdr + 40, sink->wav_bytes, 4);
+
+	if (fseek(sink->wav, 0, SEEK_SET) < 0 ||
+	    fwrite(hdr, sizeof hdr, 1, sink->wav) != 1)
+		return -errno;
+	return 0;
+}
+
+static int omxalsasink_wav_open(OMX_ALSASINK *sink, unsigned int *rate)
+{
+	if (!sink->uri) return -EINVAL;
+	if (sink->pcm_format != SND_PCM_FORMAT_U8 &&
+	    snd_pcm_format_little_endian(sink->pcm_format) != 1 &&
+	    sink->pcm_format != SND_PCM_FORMAT_A_LAW &&
+	    sink->pcm_format != SND_PCM_FORMAT_MU_LAW)
+		return -EINVAL;
+
+	sink->wav = fopen(sink->uri, "wb");
+	if (!sink->wav) return -errno;
+	sink->wav_bytes = 0;
+	sink->wav_dropped = 0;
+	return omxalsasink_wav_header(sink);
+}
+
+static void omxalsasink_wav_close(OMX_ALSASINK *sink)
+{
+	if (!sink->wav) return;
+	if (sink->wav_dropped)
+		CINFO(&sink->gcomp, 0, "%s: WAV size limit reached, %llu bytes dropped",
+			sink->uri, (unsigned long long) sink->wav_dropped);
+	if (omxalsasink_wav_header(sink) < 0)
+		CINFO(&sink->gcomp, 0, "%s: header update failed: %s", sink->uri, strerror(errno));
+	fclose(sink->wav);
+	sink->wav = 0;
+}
+
+static snd_pcm_state_t omxalsasink_wav_status(OMX_ALSASINK *sink, snd_pcm_sframes_t *delay)
+{
+	return SND_PCM_STATE_RUNNING;
+}
+
+static snd_pcm_sframes_t omxalsasink_wav_write(OMX_ALSASINK *sink, const void *data, snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t fit = (OMXWAV_MAX_BYTES - sink->wav_bytes) / sink->frame_size;
+	snd_pcm_uframes_t count = frames < fit ? frames : fit;
+	size_t n = fwrite(data, sink->frame_size, count, sink->wav);
+
+	sink->wav_bytes += n * sink->frame_size;
+	if (n != count) return -errno;
+	sink->wav_dropped += (uint64_t) (frames - count) * sink->frame_size;
+	return frames;
+}
+
+static void omxalsasink_wav_drain(OMX_ALSASINK *sink)
+{
+	fflush(sink->wav);
+}
+
+static const OMX_ALSASINK_OPS omxalsasink_wav_ops = {
+	"OMX.alsa.wav_render", false,
+	omxalsasink_wav_open,
+	omxalsasink_wav_close,
+	omxalsasink_wav_status,
+	omxalsasink_wav_write,
+	omxalsasink_wav_drain,
+};
+
 static void *omxalsasink_worker(void *ptr)
 {
 	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) ptr;
@@ -1024,12 +1407,11 @@ static void *omxalsasink_worker(void *ptr)
 	OMX_BUFFERHEADERTYPE *buf;
 	GOMX_PORT *audio_port = &comp->ports[OMXALSA_PORT_AUDIO];
 	GOMX_PORT *clock_port = &comp->ports[OMXALSA_PORT_CLOCK];
-	snd_pcm_t *dev = 0;
+	const OMX_ALSASINK_OPS *ops = sink->ops;
 	snd_pcm_sframes_t n, delay;
-	snd_pcm_hw_params_t *hwp;
-	snd_pcm_uframes_t buffer_size, period_size, period_size_max;
 	SwrContext *resampler = 0;
 	uint8_t *resample_buf = 0;
+	OMXALSA_DRIFT drift;
 	int32_t timescale;
 	uint64_t layout;
 	size_t resample_bufsz;
@@ -1040,61 +1422,42 @@ static void *omxalsasink_worker(void *ptr)
 
 	CINFO(comp, 0, "worker started");
 
-	err = snd_pcm_open(&dev, sink->device_name, SND_PCM_STREAM_PLAYBACK, 0);
-	if (err < 0) goto alsa_error;
-
 	in_sample_rate = sink->pcm.nSamplingRate;
 	rate = sink->pcm.nSamplingRate;
-	buffer_size = rate / 5;
-	period_size = buffer_size / 4;
-	period_size_max = buffer_size / 3;
+	sink->frame_size = (sink->pcm.nChannels * sink->pcm.nBitPerSample) >> 3;
 
-	snd_pcm_hw_params_alloca(&hwp);
-	snd_pcm_hw_params_any(dev, hwp);
-	err = snd_pcm_hw_params_set_channels(dev, hwp, sink->pcm.nChannels);
-	if (err) goto alsa_error;
-	err = snd_pcm_hw_params_set_access(dev, hwp, sink->pcm.bInterleaved ? SND_PCM_ACCESS_RW_INTERLEAVED : SND_PCM_ACCESS_RW_NONINTERLEAVED);
-	if (err) goto alsa_error;
-	err = snd_pcm_hw_params_set_rate_near(dev, hwp, &rate, 0);
-	if (err) goto alsa_error;
-	err = snd_pcm_hw_params_set_format(dev, hwp, sink->pcm_format);
-	if (err) goto alsa_error;
-	err = snd_pcm_hw_params_set_period_size_max(dev, hwp, &period_size_max, 0);
-	if (err) goto alsa_error;
-	err = snd_pcm_hw_params_set_buffer_size_near(dev, hwp, &buffer_size);
-	if (err) goto alsa_error;
-	err = snd_pcm_hw_params_set_period_size_near(dev, hwp, &period_size, 0);
-	if (err) goto alsa_error;
-	err = snd_pcm_hw_params(dev, hwp);
+	err = ops->open(sink, &rate);
 	if (err) goto alsa_error;
 
 	sink->pcm.nSamplingRate = rate;
-	sink->frame_size = (sink->pcm.nChannels * sink->pcm.nBitPerSample) >> 3;
 	sink->sample_rate = rate;
 
-	layout = av_get_default_channel_layout(sink->pcm.nChannels);
-	resampler = swr_alloc_set_opts(NULL,
-		/*out*/ layout, AV_SAMPLE_FMT_S16, rate,
-		/*in*/ layout, AV_SAMPLE_FMT_S16, in_sample_rate,
-		0, NULL);
-	if (!resampler) goto err;
-
-	av_opt_set_double(resampler, "cutoff", 0.985, 0);
-	av_opt_set_int(resampler,"filter_size", 64, 0);
-	if (swr_init(resampler) < 0) goto err;
-
-	resample_bufsz = audio_port->def.nBufferSize * 2;
-	resample_buf = (uint8_t *) malloc(resample_bufsz);
-	if (!resample_buf) goto err;
+	if (ops->resample) {
+		layout = av_get_default_channel_layout(sink->pcm.nChannels);
+		resampler = swr_alloc_set_opts(NULL,
+			/*out*/ layout, AV_SAMPLE_FMT_S16, rate,
+			/*in*/ layout, AV_SAMPLE_FMT_S16, in_sample_rate,
+			0, NULL);
+		if (!resampler) goto err;
+
+		av_opt_set_double(resampler, "cutoff", 0.985, 0);
+		av_opt_set_int(resampler,"filter_size", 64, 0);
+		if (swr_init(resampler) < 0) goto err;
+
+		resample_bufsz = audio_port->def.nBufferSize * 2;
+		resample_buf = (uint8_t *) malloc(resample_bufsz);
+		if (!resample_buf) goto err;
+	}
 
 	CINFO(comp, 0, "sample_rate %d, frame_size %d", rate, sink->frame_size);
 
+	memset(&drift, 0, sizeof drift);
+
 	pthread_mutex_lock(&comp->mutex);
 	while (comp->wanted_state == OMX_StateExecuting) {
 		/* Update hw buffer length, and xrun state */
-		sink->pcm_state = snd_pcm_state(dev);
 		delay = 0;
-		snd_pcm_delay(dev, &delay);
+		sink->pcm_state = ops->status(sink, &delay);
 		if (resampler) delay += swr_get_delay(resampler, rate);
 		sink->pcm_delay = delay;
 
@@ -1117,6 +1480,7 @@ static void *omxalsasink_worker(void *ptr)
 		if (clock_port->tunnel_comp && !(buf->nFlags & OMX_BUFFERFLAG_TIME_UNKNOWN)) {
 			OMX_TIME_CONFIG_TIMESTAMPTYPE tst;
 			int64_t pts = omx_ticks_to_s64(buf->nTimeStamp);
+			OMX_BOOL clock_reference = sink->clock_reference;
 
 			omx_init(tst);
 			tst.nPortIndex = clock_port->tunnel_port;
@@ -1126,6 +1490,7 @@ static void *omxalsasink_worker(void *ptr)
 			if (buf->nFlags & (OMX_BUFFERFLAG_STARTTIME|OMX_BUFFERFLAG_DISCONTINUITY)) {
 				CINFO(comp, 0, "STARTTIME nTimeStamp=%llx", pts);
 				sink->starttime = pts;
+				omxalsa_drift_reset(&drift);
 			}
 
 			pts -= (int64_t)sink->pcm_delay * OMX_TICKS_PER_SECOND / rate;
@@ -1134,8 +1499,14 @@ static void *omxalsasink_worker(void *ptr)
 			if (buf->nFlags & (OMX_BUFFERFLAG_STARTTIME|OMX_BUFFERFLAG_DISCONTINUITY))
 				OMX_SetConfig(clock_port->tunnel_comp, OMX_IndexConfigTimeClientStartTime, &tst);
 			if (pts >= sink->starttime) {
-				tst.nTimestamp = omx_ticks_from_s64(pts);
-				OMX_SetConfig(clock_port->tunnel_comp, OMX_IndexConfigTimeCurrentAudioReference, &tst);
+				if (clock_reference) {
+					tst.nTimestamp = omx_ticks_from_s64(pts);
+					OMX_SetConfig(clock_port->tunnel_comp, OMX_IndexConfigTimeCurrentAudioReference, &tst);
+				} else if (timescale == 0x10000 &&
+					   OMX_GetConfig(clock_port->tunnel_comp, OMX_IndexConfigTimeCurrentMediaTime, &tst) == OMX_ErrorNone) {
+					int64_t media_time = omx_ticks_to_s64(tst.nTimestamp);
+					omxalsa_drift_update(comp, &drift, (double)(pts - media_time) / OMX_TICKS_PER_SECOND);
+				}
 			}
 			pthread_mutex_lock(&comp->mutex);
 		}
@@ -1157,6 +1528,8 @@ static void *omxalsasink_worker(void *ptr)
 
 				if (timescale != 0x10000 && timescale >= 0x0100 && timescale <= 0x20000)
 					delta = ((int64_t)in_len*(0x10000-timescale))>>16;
+				else if (timescale == 0x10000)
+					delta = omxalsa_drift_delta(&drift, in_len);
 
 				out_len = resample_bufsz / sink->frame_size;
 				swr_set_compensation(resampler, delta, in_len);
@@ -1177,11 +1550,10 @@ static void *omxalsasink_worker(void *ptr)
 			pthread_mutex_unlock(&comp->mutex);
 
 			while (out_len > 0) {
-				n = snd_pcm_writei(dev, out_ptr, out_len);
+				n = ops->write(sink, out_ptr, out_len);
 				if (n < 0) {
-					CINFO(comp, 0, "alsa error: %ld: %s", n, snd_strerror(n));
-					snd_pcm_recover(dev, n, 1);
-					n = 0;
+					CINFO(comp, 0, "write error: %ld: %s", n, snd_strerror(n));
+					break;
 				}
 				out_len -= n;
 				n *= sink->frame_size;
@@ -1194,8 +1566,7 @@ static void *omxalsasink_worker(void *ptr)
 		if (buf->nFlags & OMX_BUFFERFLAG_EOS) {
 			CDEBUG(comp, 0, "end-of-stream");
 			pthread_mutex_unlock(&comp->mutex);
-			snd_pcm_drain(dev);
-			snd_pcm_prepare(dev);
+			ops->drain(sink);
 			pthread_mutex_lock(&comp->mutex);
 			sink->pcm_state = SND_PCM_STATE_PREPARED;
 			sink->pcm_delay = 0;
@@ -1205,14 +1576,14 @@ static void *omxalsasink_worker(void *ptr)
 	}
 	pthread_mutex_unlock(&comp->mutex);
 cleanup:
-	if (dev) snd_pcm_close(dev);
+	ops->close(sink);
 	if (resampler) swr_close(resampler);
 	free(resample_buf);
 	CINFO(comp, 0, "worker stopped");
 	return 0;
 
 alsa_error:
-	CINFO(comp, 0, "ALSA error: %s", snd_strerror(err));
+	CINFO(comp, 0, "%s error: %s", ops->name, snd_strerror(err));
 err:
 	pthread_mutex_lock(&comp->mutex);
 	/* FIXME: Current we just go to invalid state, but we might go
@@ -1274,7 +1645,7 @@ static OMX_ERRORTYPE omxalsasink_statechange(GOMX_COMPONENT *comp)
 	return OMX_ErrorNone;
 }
 
-static OMX_ERRORTYPE omxalsasink_create(OMX_HANDLETYPE *pHandle, OMX_PTR pAppData, OMX_CALLBACKTYPE *pCallbacks)
+static OMX_ERRORTYPE omxalsasink_create(OMX_HANDLETYPE *pHandle, OMX_PTR pAppData, OMX_CALLBACKTYPE *pCallbacks, const OMX_ALSASINK_OPS *ops)
 {
 	OMX_ALSASINK *sink;
 	GOMX_PORT *port;
@@ -1283,7 +1654,9 @@ static OMX_ERRORTYPE omxalsasink_create(OMX_HANDLETYPE *pHandle, OMX_PTR pAppDat
 	sink = (OMX_ALSASINK *) calloc(1, sizeof *sink);
 	if (!sink) return OMX_ErrorInsufficientResources;
 
+	sink->ops = ops;
 	strncpy(sink->device_name, "default", sizeof sink->device_name - 1);
+	sink->clock_reference = OMX_TRUE;
 	gomxq_init(&sink->playq, offsetof(OMX_BUFFERHEADERTYPE, pInputPortPrivate));
 
 	/* Audio port */
@@ -1318,7 +1691,7 @@ static OMX_ERRORTYPE omxalsasink_create(OMX_HANDLETYPE *pHandle, OMX_PTR pAppDat
 	port->def.nBufferAlignment = 4;
 	port->do_buffer = omxalsasink_clock_do_buffer;
 
-	gomx_init(&sink->gcomp, "OMX.alsa.audio_render", pAppData, pCallbacks, sink->port_data, ARRAY_SIZE(sink->port_data));
+	gomx_init(&sink->gcomp, ops->name, pAppData, pCallbacks, sink->port_data, ARRAY_SIZE(sink->port_data));
 	sink->gcomp.omx.SetParameter = omxalsasink_set_parameter;
 	sink->gcomp.omx.GetConfig = omxalsasink_get_config;
 	sink->gcomp.omx.SetConfig = omxalsasink_set_config;
@@ -1336,6 +1709,389 @@ static OMX_ERRORTYPE omxalsasink_create(OMX_HANDLETYPE *pHandle, OMX_PTR pAppDat
 	return OMX_ErrorNone;
 }
 
+/* Software Clock OMX Component
+ *
+ * A CLOCK_MONOTONIC driven replacement for OMX.broadcom.clock. Only the
+ * clock is in software: COMXAudio still decodes through
+ * OMX.broadcom.audio_decode and the broadcom mixer and splitter, and the
+ * player initialises BcmHost, so this still only runs on a Pi. The media
+ * time itself is kept by SoftClock; this component maps the configs
+ * OMXClock uses onto it, slaves it to the audio (or video) reference sent
+ * by the sink, and pushes OMX_TIME_MEDIATIMETYPE updates to its tunneled
+ * output ports on state and scale changes. */
+
+#define OMXCLOCK_NUM_PORTS		6
+
+typedef struct _OMX_SOFTCLOCK {
+	GOMX_COMPONENT gcomp;
+	GOMX_PORT port_data[OMXCLOCK_NUM_PORTS];
+	pthread_cond_t cond_notify;
+	OMX_TIME_CLOCKSTATE state;
+	OMX_TIME_REFCLOCKTYPE ref_clock;
+	OMX_U32 wait_mask;
+	int64_t offset, start_time;
+	bool start_time_valid;
+	SoftClock clock;
+	uint32_t notify;
+} OMX_SOFTCLOCK;
+
+static int64_t omxclock_host_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * OMX_TICKS_PER_SECOND + ts.tv_nsec / (1000000000 / OMX_TICKS_PER_SECOND);
+}
+
+static int64_t omxclock_media_now(OMX_SOFTCLOCK *clk)
+{
+	return clk->clock.GetMediaTime(omxclock_host_now());
+}
+
+static void omxclock_notify(OMX_SOFTCLOCK *clk)
+{
+	clk->notify = (1U << OMXCLOCK_NUM_PORTS) - 1;
+	pthread_cond_signal(&clk->cond_notify);
+}
+
+static void omxclock_start(OMX_SOFTCLOCK *clk, int64_t start)
+{
+	CINFO(&clk->gcomp, 0, "running from %lld", (long long) start);
+	clk->state = OMX_TIME_ClockStateRunning;
+	clk->clock.Start(start, omxclock_host_now());
+	omxclock_notify(clk);
+}
+
+/* Called with the component mutex held */
+static void omxclock_send_updates(OMX_SOFTCLOCK *clk)
+{
+	GOMX_COMPONENT *comp = &clk->gcomp;
+	OMX_BUFFERHEADERTYPE *hdr;
+	OMX_TIME_MEDIATIMETYPE *mt;
+	OMX_ERRORTYPE r;
+
+	for (size_t i = 0; i < comp->nports; i++) {
+		GOMX_PORT *port = &comp->ports[i];
+		uint32_t bit = 1U << i;
+
+		if (!(clk->notify & bit)) continue;
+		if (!port->def.bEnabled || !port->tunnel_comp) {
+			clk->notify &= ~bit;
+			continue;
+		}
+		hdr = (OMX_BUFFERHEADERTYPE *) gomxq_dequeue(&port->tunnel_supplierq);
+		if (!hdr) continue;
+
+		mt = (OMX_TIME_MEDIATIMETYPE *) hdr->pBuffer;
+		memset(mt, 0, sizeof *mt);
+		omx_init(*mt);
+		mt->eUpdateType = OMX_TIME_UpdateClockStateChanged;
+		mt->nMediaTimestamp = omx_ticks_from_s64(omxclock_media_now(clk));
+		mt->nOffset = omx_ticks_from_s64(clk->offset);
+		mt->nWallTimeAtMediaTime = omxclock_host_now();
+		mt->xScale = clk->clock.GetScale();
+		mt->eState = clk->state;
+		hdr->nOffset = 0;
+		hdr->nFilledLen = sizeof *mt;
+		hdr->nFlags = 0;
+		hdr->nTimeStamp = mt->nMediaTimestamp;
+		clk->notify &= ~bit;
+
+		pthread_mutex_unlock(&comp->mutex);
+		r = OMX_EmptyThisBuffer(port->tunnel_comp, hdr);
+		pthread_mutex_lock(&comp->mutex);
+		if (r != OMX_ErrorNone) {
+			/* Peer not ready yet, retry from the worker */
+			__gomx_port_queue_supplier_buffer(port, hdr);
+			clk->notify |= bit;
+		}
+	}
+}
+
+static void *omxclock_worker(void *ptr)
+{
+	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) ptr;
+	OMX_SOFTCLOCK *clk = (OMX_SOFTCLOCK *) comp;
+	struct timespec ts;
+
+	CINFO(comp, 0, "worker started");
+	pthread_mutex_lock(&comp->mutex);
+	omxclock_notify(clk);
+	while (comp->wanted_state == OMX_StateExecuting) {
+		omxclock_send_updates(clk);
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ts.tv_nsec += 20000000UL; /* 20 ms */
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_nsec -= 1000000000UL;
+			ts.tv_sec++;
+		}
+		pthread_cond_timedwait(&clk->cond_notify, &comp->mutex, &ts);
+	}
+	pthread_mutex_unlock(&comp->mutex);
+	CINFO(comp, 0, "worker stopped");
+	return 0;
+}
+
+static OMX_ERRORTYPE omxclock_port_do_buffer(GOMX_COMPONENT *comp, GOMX_PORT *port, OMX_BUFFERHEADERTYPE *buf)
+{
+	OMX_SOFTCLOCK *clk = (OMX_SOFTCLOCK *) comp;
+	__gomx_port_queue_supplier_buffer(port, buf);
+	if (clk->notify) pthread_cond_signal(&clk->cond_notify);
+	return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE omxclock_get_parameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nParamIndex, OMX_PTR pComponentParameterStructure)
+{
+	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) hComponent;
+	OMX_PARAM_BUFFERSUPPLIERTYPE *suppl;
+	GOMX_PORT *port;
+	OMX_ERRORTYPE r;
+
+	switch (nParamIndex) {
+	case OMX_IndexParamCompBufferSupplier:
+		if ((r = omx_cast(suppl, pComponentParameterStructure))) return r;
+		if (!(port = gomx_get_port(comp, suppl->nPortIndex))) return OMX_ErrorBadPortIndex;
+		suppl->eBufferSupplier = port->tunnel_supplier ? OMX_BufferSupplyOutput : OMX_BufferSupplyInput;
+		return OMX_ErrorNone;
+	default:
+		return gomx_get_parameter(hComponent, nParamIndex, pComponentParameterStructure);
+	}
+}
+
+static OMX_ERRORTYPE omxclock_set_parameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nParamIndex, OMX_PTR pComponentParameterStructure)
+{
+	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) hComponent;
+	OMX_PARAM_BUFFERSUPPLIERTYPE *suppl;
+	OMX_PARAM_PORTDEFINITIONTYPE *pdt;
+	GOMX_PORT *port;
+	OMX_ERRORTYPE r;
+
+	if (comp->state == OMX_StateInvalid) return OMX_ErrorInvalidState;
+
+	switch (nParamIndex) {
+	case OMX_IndexParamPortDefinition:
+		if ((r = omx_cast(pdt, pComponentParameterStructure))) return r;
+		if (!(port = gomx_get_port(comp, pdt->nPortIndex))) return OMX_ErrorBadPortIndex;
+		if (comp->state != OMX_StateLoaded && port->def.bEnabled)
+			return OMX_ErrorIncorrectStateOperation;
+		if (pdt->nBufferCountActual < port->def.nBufferCountMin ||
+		    pdt->nBufferSize < sizeof(OMX_TIME_MEDIATIMETYPE))
+			return OMX_ErrorBadParameter;
+		port->def.nBufferCountActual = pdt->nBufferCountActual;
+		port->def.nBufferSize = pdt->nBufferSize;
+		break;
+	case OMX_IndexParamCompBufferSupplier:
+		if ((r = omx_cast(suppl, pComponentParameterStructure))) return r;
+		if (!(port = gomx_get_port(comp, suppl->nPortIndex))) return OMX_ErrorBadPortIndex;
+		port->tunnel_supplier = (suppl->eBufferSupplier == OMX_BufferSupplyOutput);
+		CDEBUG(comp, port, "OMX_IndexParamCompBufferSupplier %d", suppl->eBufferSupplier);
+		break;
+	default:
+		CINFO(comp, 0, "UNSUPPORTED %x, %p", nParamIndex, pComponentParameterStructure);
+		return OMX_ErrorNotImplemented;
+	}
+	return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE omxclock_get_config(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pComponentConfigStructure)
+{
+	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) hComponent;
+	OMX_SOFTCLOCK *clk = (OMX_SOFTCLOCK *) hComponent;
+	OMX_TIME_CONFIG_TIMESTAMPTYPE *tst;
+	OMX_TIME_CONFIG_CLOCKSTATETYPE *cst;
+	OMX_TIME_CONFIG_SCALETYPE *sct;
+	OMX_ERRORTYPE r;
+
+	if (comp->state == OMX_StateInvalid) return OMX_ErrorInvalidState;
+
+	pthread_mutex_lock(&comp->mutex);
+	switch (nIndex) {
+	case OMX_IndexConfigTimeCurrentMediaTime:
+		if ((r = omx_cast(tst, pComponentConfigStructure))) break;
+		tst->nTimestamp = omx_ticks_from_s64(omxclock_media_now(clk));
+		break;
+	case OMX_IndexConfigClockAdjustment:
+		if ((r = omx_cast(tst, pComponentConfigStructure))) break;
+		tst->nTimestamp = omx_ticks_from_s64(0);
+		break;
+	case OMX_IndexConfigTimeClockState:
+		if ((r = omx_cast(cst, pComponentConfigStructure))) break;
+		cst->eState = clk->state;
+		cst->nStartTime = omx_ticks_from_s64(clk->start_time);
+		cst->nOffset = omx_ticks_from_s64(clk->offset);
+		cst->nWaitMask = clk->wait_mask;
+		break;
+	case OMX_IndexConfigTimeScale:
+		if ((r = omx_cast(sct, pComponentConfigStructure))) break;
+		sct->xScale = clk->clock.GetScale();
+		break;
+	default:
+		CINFO(comp, 0, "UNSUPPORTED %x, %p", nIndex, pComponentConfigStructure);
+		r = OMX_ErrorNotImplemented;
+		break;
+	}
+	pthread_mutex_unlock(&comp->mutex);
+	return r;
+}
+
+static OMX_ERRORTYPE omxclock_set_config(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pComponentConfigStructure)
+{
+	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) hComponent;
+	OMX_SOFTCLOCK *clk = (OMX_SOFTCLOCK *) hComponent;
+	OMX_TIME_CONFIG_TIMESTAMPTYPE *tst;
+	OMX_TIME_CONFIG_CLOCKSTATETYPE *cst;
+	OMX_TIME_CONFIG_SCALETYPE *sct;
+	OMX_TIME_CONFIG_ACTIVEREFCLOCKTYPE *rct;
+	OMX_PARAM_U32TYPE *u32param;
+	OMX_ERRORTYPE r;
+	int64_t ts;
+
+	if (comp->state == OMX_StateInvalid) return OMX_ErrorInvalidState;
+
+	pthread_mutex_lock(&comp->mutex);
+	switch (nIndex) {
+	case OMX_IndexConfigTimeClockState:
+		if ((r = omx_cast(cst, pComponentConfigStructure))) break;
+		CDEBUG(comp, 0, "OMX_IndexConfigTimeClockState %d, wait mask %x", cst->eState, cst->nWaitMask);
+		clk->offset = omx_ticks_to_s64(cst->nOffset);
+		switch (cst->eState) {
+		case OMX_TIME_ClockStateRunning:
+			omxclock_start(clk, omx_ticks_to_s64(cst->nStartTime));
+			break;
+		case OMX_TIME_ClockStateWaitingForStartTime:
+			clk->clock.Stop(omxclock_host_now());
+			clk->state = cst->eState;
+			clk->wait_mask = cst->nWaitMask;
+			clk->start_time_valid = false;
+			if (!clk->wait_mask)
+				omxclock_start(clk, omxclock_media_now(clk));
+			break;
+		default:
+			clk->clock.Stop(omxclock_host_now());
+			clk->state = OMX_TIME_ClockStateStopped;
+			break;
+		}
+		omxclock_notify(clk);
+		break;
+	case OMX_IndexConfigTimeScale:
+		if ((r = omx_cast(sct, pComponentConfigStructure))) break;
+		CDEBUG(comp, 0, "OMX_IndexConfigTimeScale %x", sct->xScale);
+		clk->clock.SetScale(sct->xScale, omxclock_host_now());
+		omxclock_notify(clk);
+		break;
+	case OMX_IndexConfigTimeActiveRefClock:
+		if ((r = omx_cast(rct, pComponentConfigStructure))) break;
+		clk->ref_clock = rct->eClock;
+		break;
+	case OMX_IndexConfigTimeClientStartTime:
+		if ((r = omx_cast(tst, pComponentConfigStructure))) break;
+		ts = omx_ticks_to_s64(tst->nTimestamp);
+		CDEBUG(comp, 0, "OMX_IndexConfigTimeClientStartTime port %d, %lld", tst->nPortIndex, (long long) ts);
+		if (clk->state != OMX_TIME_ClockStateWaitingForStartTime)
+			break;
+		if (!clk->start_time_valid || ts < clk->start_time)
+			clk->start_time = ts;
+		clk->start_time_valid = true;
+		clk->wait_mask &= ~(1U << tst->nPortIndex);
+		if (!clk->wait_mask)
+			omxclock_start(clk, clk->start_time + clk->offset);
+		break;
+	case OMX_IndexConfigTimeCurrentAudioReference:
+	case OMX_IndexConfigTimeCurrentVideoReference:
+		if ((r = omx_cast(tst, pComponentConfigStructure))) break;
+		if ((nIndex == OMX_IndexConfigTimeCurrentAudioReference) ==
+		    (clk->ref_clock == OMX_TIME_RefClockAudio))
+			clk->clock.Reference(omx_ticks_to_s64(tst->nTimestamp), omxclock_host_now());
+		break;
+	case OMX_IndexConfigSingleStep:
+		if ((r = omx_cast(u32param, pComponentConfigStructure))) break;
+		clk->clock.Step(u32param->nU32, omxclock_host_now());
+		break;
+	case OMX_IndexConfigLatencyTarget:
+		/* HDMI clock sync has no meaning without the firmware */
+		r = OMX_ErrorNone;
+		break;
+	default:
+		CINFO(comp, 0, "UNSUPPORTED %x, %p", nIndex, pComponentConfigStructure);
+		r = OMX_ErrorNotImplemented;
+		break;
+	}
+	pthread_mutex_unlock(&comp->mutex);
+	return r;
+}
+
+static OMX_ERRORTYPE omxclock_get_extension_index(OMX_HANDLETYPE hComponent, OMX_STRING cParameterName, OMX_INDEXTYPE *pIndexType)
+{
+	GOMX_COMPONENT *comp = (GOMX_COMPONENT *) hComponent;
+	CINFO(comp, 0, "UNSUPPORTED '%s', %p", cParameterName, pIndexType);
+	return OMX_ErrorNotImplemented;
+}
+
+static OMX_ERRORTYPE omxclock_statechange(GOMX_COMPONENT *comp)
+{
+	OMX_SOFTCLOCK *clk = (OMX_SOFTCLOCK *) comp;
+	pthread_cond_signal(&clk->cond_notify);
+	return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE omxclock_deinit(OMX_HANDLETYPE hComponent)
+{
+	OMX_SOFTCLOCK *clk = (OMX_SOFTCLOCK *) hComponent;
+	gomx_fini(&clk->gcomp);
+	pthread_cond_destroy(&clk->cond_notify);
+	clk->clock.~SoftClock();
+	free(clk);
+	return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE omxclock_create(OMX_HANDLETYPE *pHandle, OMX_PTR pAppData, OMX_CALLBACKTYPE *pCallbacks)
+{
+	OMX_SOFTCLOCK *clk;
+	GOMX_PORT *port;
+	pthread_condattr_t attr;
+
+	clk = (OMX_SOFTCLOCK *) calloc(1, sizeof *clk);
+	if (!clk) return OMX_ErrorInsufficientResources;
+
+	clk->state = OMX_TIME_ClockStateStopped;
+	clk->ref_clock = OMX_TIME_RefClockNone;
+	new (&clk->clock) SoftClock();
+
+	for (size_t i = 0; i < ARRAY_SIZE(clk->port_data); i++) {
+		port = &clk->port_data[i];
+		port->def.nSize = sizeof *port;
+		port->def.nVersion.nVersion = OMX_VERSION;
+		port->def.nPortIndex = i;
+		port->def.eDir = OMX_DirOutput;
+		port->def.nBufferCountMin = 1;
+		port->def.nBufferCountActual = 1;
+		port->def.nBufferSize = sizeof(OMX_TIME_MEDIATIMETYPE);
+		port->def.bEnabled = OMX_TRUE;
+		port->def.eDomain = OMX_PortDomainOther;
+		port->def.format.other.eFormat = OMX_OTHER_FormatTime;
+		port->def.nBufferAlignment = 4;
+		port->do_buffer = omxclock_port_do_buffer;
+	}
+
+	gomx_init(&clk->gcomp, "OMX.alsa.clock", pAppData, pCallbacks, clk->port_data, ARRAY_SIZE(clk->port_data));
+	clk->gcomp.omx.GetParameter = omxclock_get_parameter;
+	clk->gcomp.omx.SetParameter = omxclock_set_parameter;
+	clk->gcomp.omx.GetConfig = omxclock_get_config;
+	clk->gcomp.omx.SetConfig = omxclock_set_config;
+	clk->gcomp.omx.GetExtensionIndex = omxclock_get_extension_index;
+	clk->gcomp.omx.ComponentDeInit = omxclock_deinit;
+	clk->gcomp.worker = omxclock_worker;
+	clk->gcomp.statechange = omxclock_statechange;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&clk->cond_notify, &attr);
+	pthread_condattr_destroy(&attr);
+
+	*pHandle = (OMX_HANDLETYPE) clk;
+	return OMX_ErrorNone;
+}
+
 /* OMX Glue to get the handle */
 
 #include <OMXAlsa.h>
@@ -1343,8 +2099,18 @@ static OMX_ERRORTYPE omxalsasink_create(OMX_HANDLETYPE *pHandle, OMX_PTR pAppDat
 OMX_ERRORTYPE OMXALSA_GetHandle(OMX_OUT OMX_HANDLETYPE* pHandle, OMX_IN OMX_STRING cComponentName,
 				OMX_IN  OMX_PTR pAppData, OMX_IN OMX_CALLBACKTYPE* pCallbacks)
 {
-	if (strcmp(cComponentName, "OMX.alsa.audio_render") == 0)
-		return omxalsasink_create(pHandle, pAppData, pCallbacks);
+	static const OMX_ALSASINK_OPS *sinks[] = {
+		&omxalsasink_alsa_ops,
+		&omxalsasink_null_ops,
+		&omxalsasink_wav_ops,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(sinks); i++)
+		if (strcmp(cComponentName, sinks[i]->name) == 0)
+			return omxalsasink_create(pHandle, pAppData, pCallbacks, sinks[i]);
+
+	if (strcmp(cComponentName, "OMX.alsa.clock") == 0)
+		return omxclock_create(pHandle, pAppData, pCallbacks);
 
 	return OMX_ErrorComponentNotFound;
 }
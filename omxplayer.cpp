@@ -58,6 +58,8 @@ extern "C" {
 #include "KeyConfig.h"
 #include "utils/Strprintf.h"
 #include "Keyboard.h"
+#include "OMXEventLoop.h"
+#include "LatencyController.h"
 #include "utils/RegExp.h"
 #include "AutoPlaylist.h"
 #include "RecentFileStore.h"
@@ -98,10 +100,34 @@ int               m_audio_index     = -1;
 OMXClock          *m_av_clock           = NULL;
 OMXControl        m_omxcontrol;
 Keyboard          *m_keyboard           = NULL;
+OMXEventLoop      m_event_loop;
 OMXAudioConfig    m_config_audio;
 OMXVideoConfig    m_config_video;
 OMXPacket         *m_omx_pkt            = NULL;
+
+// Packets demuxed for a player whose queue was full. Staging them lets the
+// main loop keep feeding the other streams instead of waiting on this one.
+struct PacketBacklog
+{
+  std::deque<OMXPacket *> packets;
+  unsigned int            size       = 0;
+  int64_t                 blocked_at = 0;  // demux held up by this backlog since
+  int64_t                 blocked    = 0;  // total time demux was held up [us]
+};
+PacketBacklog     m_video_backlog;
+PacketBacklog     m_audio_backlog;
+// Seek requests from the first one of a burst until playback resumes
+struct SeekBurst
+{
+  int64_t      start     = 0;
+  unsigned int requests  = 0;
+  unsigned int seeks     = 0;
+  unsigned int cancelled = 0;
+  int64_t      flush     = 0;  // spent in FlushStreams [us]
+};
+SeekBurst         m_seek_burst;
 bool              m_no_hdmi_clock_sync  = false;
+bool              m_soft_clock          = false;
 bool              m_stop                = false;
 int               m_subtitle_index      = -1;
 DllBcmHost        m_BcmHost;
@@ -240,8 +266,126 @@ static float get_display_aspect_ratio(SDTV_ASPECT_T aspect)
   return display_aspect;
 }
 
+// Tracks whether the backlog is full and so blocks demuxing for every stream
+static bool BacklogBlocking(PacketBacklog &backlog, unsigned int limit, int64_t now)
+{
+  bool full = !backlog.packets.empty() && backlog.size >= limit;
+
+  if (full && !backlog.blocked_at)
+    backlog.blocked_at = now;
+  else if (!full && backlog.blocked_at)
+  {
+    backlog.blocked += now - backlog.blocked_at;
+    backlog.blocked_at = 0;
+  }
+  return full;
+}
+
+static double BacklogBlockedTime(const PacketBacklog &backlog)
+{
+  int64_t blocked = backlog.blocked;
+  if (backlog.blocked_at)
+    blocked += OMXClock::GetAbsoluteClock() - backlog.blocked_at;
+  return blocked * 1e-6;
+}
+
+static void ClearBacklog(PacketBacklog &backlog)
+{
+  BacklogBlocking(backlog, 0, OMXClock::GetAbsoluteClock());
+  for (OMXPacket *pkt : backlog.packets)
+    delete pkt;
+  backlog.packets.clear();
+  backlog.size = 0;
+}
+
+// Queues a packet behind any staged ones, staging it when the player is full
+template <class Player>
+static void StagePacket(PacketBacklog &backlog, Player &player, OMXPacket *pkt)
+{
+  if (backlog.packets.empty() && player.AddPacket(pkt))
+    return;
+  backlog.packets.push_back(pkt);
+  backlog.size += pkt->size;
+}
+
+template <class Player>
+static void DrainBacklog(PacketBacklog &backlog, Player &player)
+{
+  while (!backlog.packets.empty() && player.AddPacket(backlog.packets.front()))
+  {
+    backlog.size -= backlog.packets.front()->size;
+    backlog.packets.pop_front();
+  }
+}
+
+// Whether a staged packet at or after pts is waiting for the player
+static bool BacklogReaches(const PacketBacklog &backlog, int64_t pts)
+{
+  for (const OMXPacket *pkt : backlog.packets)
+    if (pkt->pts != AV_NOPTS_VALUE && pkt->pts >= pts)
+      return true;
+  return false;
+}
+
+static void SkipBacklog(PacketBacklog &backlog, int64_t pts)
+{
+  while (!backlog.packets.empty())
+  {
+    OMXPacket *pkt = backlog.packets.front();
+    if (pkt->pts != AV_NOPTS_VALUE && pkt->pts >= pts)
+      break;
+    backlog.size -= pkt->size;
+    backlog.packets.pop_front();
+    delete pkt;
+  }
+}
+
+// Satisfies a short forward seek from packets already demuxed: the players
+// skip ahead to the first video keyframe at or after target instead of
+// flushing everything and demuxing the same data again. On failure the
+// caller falls back to a full seek, which flushes whatever was skipped.
+static bool SeekInQueues(int64_t target, int64_t *startpts)
+{
+  int64_t start = target;
+
+  m_av_clock->OMXStop();
+  m_av_clock->OMXPause();
+
+  if(m_has_video && !m_player_video.SkipTo(target, start))
+    return false;
+
+  if(m_has_audio)
+  {
+    if(!m_player_audio.SkipTo(start, BacklogReaches(m_audio_backlog, start)))
+      return false;
+    SkipBacklog(m_audio_backlog, start);
+  }
+
+  if(m_has_video)
+    m_player_video.WaitFlushed();
+
+  if(m_has_audio)
+    m_player_audio.WaitFlushed();
+
+  m_av_clock->OMXMediaTime(start);
+  *startpts = start;
+  return true;
+}
+
+static void SeekBurstSettled()
+{
+  if (!m_seek_burst.start)
+    return;
+  CLog::Log(LOGINFO, "Seek: %u requests, %u seeks (%u cancelled) settled in %.3fs, %.1fms flushing",
+    m_seek_burst.requests, m_seek_burst.seeks, m_seek_burst.cancelled,
+    (OMXClock::GetAbsoluteClock() - m_seek_burst.start) * 1e-6, m_seek_burst.flush * 1e-3);
+  m_seek_burst = SeekBurst();
+}
+
 static void FlushStreams(int64_t pts)
 {
+  int64_t start = OMXClock::GetAbsoluteClock();
+
   m_av_clock->OMXStop();
   m_av_clock->OMXPause();
 
@@ -251,6 +395,13 @@ static void FlushStreams(int64_t pts)
   if(m_has_audio)
     m_player_audio.Flush();
 
+  // Both decoders reset in parallel, the clock must not see their old data
+  if(m_has_video)
+    m_player_video.WaitFlushed();
+
+  if(m_has_audio)
+    m_player_audio.WaitFlushed();
+
   if(pts != AV_NOPTS_VALUE)
     m_av_clock->OMXMediaTime(pts);
 
@@ -262,6 +413,12 @@ static void FlushStreams(int64_t pts)
     delete m_omx_pkt;
     m_omx_pkt = NULL;
   }
+
+  ClearBacklog(m_video_backlog);
+  ClearBacklog(m_audio_backlog);
+
+  if (m_seek_burst.start)
+    m_seek_burst.flush += OMXClock::GetAbsoluteClock() - start;
 }
 
 static void CallbackTvServiceCallback(void *userdata, uint32_t reason, uint32_t param1, uint32_t param2)
@@ -550,6 +707,10 @@ int main(int argc, char *argv[])
   uint32_t              m_blank_background    = 0;
   bool sentStarted = false;
   float m_threshold      = -1.0f; // amount of audio/video required to come out of buffering
+  float m_live_latency   = -1.0f; // target latency for --live, defaults to the threshold
+  float m_live_skew      = 1.0f; // max clock speed deviation for --live [%]
+  float m_back_buffer    = 0.0f; // packets kept for backward seeks [MB], 0 disables
+  int m_position_signal  = 0; // interval of the DBus position signal [ms], 0 disables
   float m_timeout        = 10.0f; // amount of time file/network operation can stall for before timing out
   int m_orientation      = -1; // unset
   float m_fps            = 0.0f; // unset
@@ -603,6 +764,11 @@ int main(int argc, char *argv[])
   const int avdict_opt      = 0x401;
   const int track_opt       = 0x402;
   const int start_paused_opt = 0x403;
+  const int soft_clock_opt   = 0x404;
+  const int live_latency_opt = 0x405;
+  const int live_skew_opt    = 0x406;
+  const int back_buffer_opt  = 0x407;
+  const int position_signal_opt = 0x408;
 
   struct option longopts[] = {
     { "info",         no_argument,        NULL,          'i' },
@@ -663,6 +829,11 @@ int main(int argc, char *argv[])
     { "avdict",       required_argument,  NULL,          avdict_opt },
     { "track",        required_argument,  NULL,          track_opt },
     { "start-paused", no_argument,        NULL,          start_paused_opt },
+    { "soft-clock",   no_argument,        NULL,          soft_clock_opt },
+    { "live-latency", required_argument,  NULL,          live_latency_opt },
+    { "live-skew",    required_argument,  NULL,          live_skew_opt },
+    { "back-buffer",  required_argument,  NULL,          back_buffer_opt },
+    { "position-signal", required_argument, NULL,        position_signal_opt },
     { 0, 0, 0, 0 }
   };
 
@@ -670,8 +841,8 @@ int main(int argc, char *argv[])
   int playspeeds[] = {S(0), S(1/16.0), S(1/8.0), S(1/4.0), S(1/2.0), S(0.975), S(1.0), S(1.125), S(-32.0), S(-16.0), S(-8.0), S(-4), S(-2), S(-1), S(1), S(2.0), S(4.0), S(8.0), S(16.0), S(32.0)};
   const int playspeed_slow_min = 0, playspeed_slow_max = 7, playspeed_rew_max = 8, playspeed_rew_min = 13, playspeed_normal = 14, playspeed_ff_min = 15, playspeed_ff_max = 19;
   int playspeed_current = playspeed_normal;
-  int64_t m_last_check_time = 0;
-  float m_latency = 0.0f;
+  int m_wait_ms = 0;
+  LatencyController m_latency_controller;
   int c;
   std::string mode;
 
@@ -755,9 +926,14 @@ int main(int argc, char *argv[])
           }
         }
         if(m_config_audio.device != "local" && m_config_audio.device != "hdmi" && m_config_audio.device != "both" &&
-           m_config_audio.device != "alsa")
+           m_config_audio.device != "alsa" && m_config_audio.device != "null" && m_config_audio.device != "wav")
+        {
+          printf("Bad argument for -%c: Output device must be `local', `hdmi', `both', `alsa', `null' or `wav'\n", c);
+          return EXIT_FAILURE;
+        }
+        if(m_config_audio.device == "wav" && m_config_audio.subdevice.empty())
         {
-          printf("Bad argument for -%c: Output device must be `local', `hdmi', `both' or `alsa'\n", c);
+          printf("Bad argument for -%c: `wav' output needs a file name, e.g. wav:out.wav\n", c);
           return EXIT_FAILURE;
         }
         m_config_audio.device = "omx:" + m_config_audio.device;
@@ -947,6 +1123,31 @@ int main(int argc, char *argv[])
       case start_paused_opt:
         m_Pause = true;
         break;
+      case soft_clock_opt:
+        m_soft_clock = true;
+        break;
+      case live_latency_opt:
+        m_live_latency = atof(optarg);
+        if(!(m_live_latency > 0.0f))
+        {
+          printf("Bad argument for --live-latency: must be a positive number of seconds\n");
+          return EXIT_FAILURE;
+        }
+        break;
+      case live_skew_opt:
+        m_live_skew = atof(optarg);
+        if(!(m_live_skew > 0.0f))
+        {
+          printf("Bad argument for --live-skew: must be a positive percentage\n");
+          return EXIT_FAILURE;
+        }
+        break;
+      case back_buffer_opt:
+        m_back_buffer = atof(optarg);
+        break;
+      case position_signal_opt:
+        m_position_signal = atoi(optarg);
+        break;
       case 0:
         break;
       case 'h':
@@ -970,6 +1171,18 @@ int main(int argc, char *argv[])
     }
   }
 
+  // Only the ALSA sinks can follow the software clock, the broadcom renderers can't
+  if (m_soft_clock)
+  {
+    if (m_config_audio.device.empty())
+      m_config_audio.device = "omx:alsa";
+    if (m_config_audio.device != "omx:alsa" && m_config_audio.device != "omx:null" && m_config_audio.device != "omx:wav")
+    {
+      printf("--soft-clock requires output device `alsa', `null' or `wav'\n");
+      return EXIT_FAILURE;
+    }
+  }
+
   if (optind >= argc) {
     print_usage();
     return EXIT_SUCCESS;
@@ -1109,6 +1322,7 @@ int main(int argc, char *argv[])
     &m_omx_reader,
     m_dbus_name
   );
+  m_omxcontrol.setPositionInterval(m_position_signal);
   if (false == m_no_keys)
   {
     m_keyboard = new Keyboard();
@@ -1119,6 +1333,28 @@ int main(int argc, char *argv[])
     m_keyboard->setDbusName(m_dbus_name);
   }
 
+  // The main loop sleeps until control input, queue space or the buffering timer
+  if (m_event_loop.Open())
+  {
+    m_event_loop.AddControlFd(m_omxcontrol.getFd());
+    m_player_audio.SetEventLoop(&m_event_loop);
+    m_player_video.SetEventLoop(&m_event_loop);
+    if (NULL != m_keyboard)
+      m_keyboard->setEventLoop(&m_event_loop);
+  }
+
+  // Only input that moves the position again supersedes a seek, status
+  // polls and other calls are answered once it's done
+  auto seek_pending = [control_err]
+  {
+    if (control_err)
+      return m_keyboard && KeyConfig::isSeekAction(m_keyboard->peekEvent());
+    return m_omxcontrol.seekPending();
+  };
+
+  // A seek still in flight gives way to newer position commands
+  m_omx_reader.SetSeekCancel(seek_pending);
+
   change_file:
 
   if(m_filename.substr(m_filename.size()-4, 4) == ".iso"
@@ -1237,6 +1473,19 @@ int main(int argc, char *argv[])
     m_has_video = false;
   }
 
+  if (m_soft_clock && m_has_video)
+  {
+    CLog::Log(LOGWARNING, "%s - Ignoring video with software clock:%s", __FUNCTION__, m_filename.c_str());
+    m_has_video = false;
+  }
+
+  // Badly interleaved files get a second demux cursor rather than overflow a queue
+  if (m_has_video && m_has_audio)
+    m_omx_reader.SetInterleaveLimits(m_config_video.queue_size * 1024 * 1024, m_config_audio.queue_size * 1024 * 1024);
+
+  if (m_back_buffer > 0.0f)
+    m_omx_reader.SetBackBuffer(m_back_buffer * 1024 * 1024);
+
   if(m_filename.find("3DSBS") != string::npos || m_filename.find("HSBS") != string::npos)
     m_3d = CONF_FLAGS_FORMAT_SBS;
   else if(m_filename.find("3DTAB") != string::npos || m_filename.find("HTAB") != string::npos)
@@ -1250,7 +1499,7 @@ int main(int argc, char *argv[])
   if ((m_refresh || m_NativeDeinterlace) && !m_no_hdmi_clock_sync)
     m_config_video.hdmi_clock_sync = true;
 
-  if(!m_av_clock->OMXInitialize())
+  if(!m_av_clock->OMXInitialize(m_soft_clock))
     ExitGentlyOnError();
 
   if(m_config_video.hdmi_clock_sync && !m_av_clock->HDMIClockSync())
@@ -1296,9 +1545,13 @@ int main(int argc, char *argv[])
 
   if(m_has_subtitle || m_osd)
   {
-    std::vector<Subtitle> external_subtitles;
-    if(m_has_external_subtitles && !ReadSrt(m_external_subtitles_path, external_subtitles))
-       ExitGentlyWithMessage("Unable to read the subtitle file");
+    std::shared_ptr<SubtitleFileReader> external_subtitles;
+    if(m_has_external_subtitles)
+    {
+      external_subtitles = std::make_shared<SubtitleFileReader>();
+      if(!external_subtitles->Open(m_external_subtitles_path))
+        ExitGentlyWithMessage("Unable to read the subtitle file");
+    }
 
     if(!m_player_subtitles.Open(m_omx_reader.SubtitleStreamCount(),
                                 std::move(external_subtitles)))
@@ -1364,6 +1617,9 @@ int main(int argc, char *argv[])
   if (m_threshold < 0.0f)
     m_threshold = m_config_audio.is_live ? 0.7f : 0.2f;
 
+  m_latency_controller.SetTarget(m_live_latency < 0.0f ? m_threshold : m_live_latency);
+  m_latency_controller.SetMaxDeviation(m_live_skew / 100.0f);
+
   PrintSubtitleInfo();
 
   m_av_clock->OMXReset(m_has_video, m_has_audio);
@@ -1373,25 +1629,25 @@ int main(int argc, char *argv[])
   // forget seek time fo all files being played
   if(!m_is_dvd_device) m_file_store.forget(m_filename);
 
+  m_omxcontrol.trackChanged();
+
   while(!m_stop)
   {
     if(g_abort)
       goto do_exit;
 
-    int64_t now = OMXClock::GetAbsoluteClock();
-    bool update = false;
+    m_event_loop.SetTimer(m_Pause ? 200 : 20);
+    unsigned int events = m_event_loop.Wait(m_wait_ms);
+    bool update = (events & OMXEventLoop::EVENT_TIMER) != 0;
+    m_wait_ms = 0;
     m_chapter_seek = false;
-    if (m_last_check_time == 0 || m_last_check_time + 20000 <= now)
-    {
-      update = true;
-      m_last_check_time = now;
-    }
 
-     if (update) {
+     if (events || m_omxcontrol.pending()) {
        OMXControlResult result = control_err
                                ? (OMXControlResult)(m_keyboard ? m_keyboard->getEvent() : KeyConfig::ACTION_BLANK)
                                : m_omxcontrol.getEvent();
        double oldPos, newPos;
+       double incr = m_incr;
 
     switch(result.getKey())
     {
@@ -1509,7 +1765,7 @@ int main(int argc, char *argv[])
           }
           else
           {
-            m_incr = -600;
+            m_incr -= 600;
           }
         }
         break;
@@ -1538,7 +1794,7 @@ int main(int argc, char *argv[])
           }
           else
           {
-            m_incr = 600;
+            m_incr += 600;
           }
         }
         break;
@@ -1648,19 +1904,19 @@ int main(int argc, char *argv[])
         goto do_exit;
         break;
       case KeyConfig::ACTION_SEEK_BACK_SMALL:
-        if(m_omx_reader.CanSeek()) m_incr = -30;
+        if(m_omx_reader.CanSeek()) m_incr -= 30;
         break;
       case KeyConfig::ACTION_SEEK_FORWARD_SMALL:
-        if(m_omx_reader.CanSeek()) m_incr = 30;
+        if(m_omx_reader.CanSeek()) m_incr += 30;
         break;
       case KeyConfig::ACTION_SEEK_FORWARD_LARGE:
-        if(m_omx_reader.CanSeek()) m_incr = 600;
+        if(m_omx_reader.CanSeek()) m_incr += 600;
         break;
       case KeyConfig::ACTION_SEEK_BACK_LARGE:
-        if(m_omx_reader.CanSeek()) m_incr = -600;
+        if(m_omx_reader.CanSeek()) m_incr -= 600;
         break;
       case KeyConfig::ACTION_SEEK_RELATIVE:
-          m_incr = result.getArg() * 1e-6;
+          m_incr += result.getArg() * 1e-6;
           break;
       case KeyConfig::ACTION_SEEK_ABSOLUTE:
           newPos = result.getArg() * 1e-6;
@@ -1749,19 +2005,37 @@ int main(int argc, char *argv[])
       default:
         break;
     }
+
+    if (m_incr != incr)
+    {
+      if (!m_seek_burst.start)
+        m_seek_burst.start = OMXClock::GetAbsoluteClock();
+      m_seek_burst.requests++;
+    }
     }
 
+    m_omxcontrol.update(m_Pause);
+
     if (idle)
     {
-      usleep(10000);
+      m_wait_ms = -1;
       continue;
     }
 
+    // Relative seeks add up, so take in the rest of a burst before seeking
+    if (m_incr != 0 && !m_chapter_seek && seek_pending())
+      continue;
+
     if(m_seek_flush || m_incr != 0)
     {
       double seek_pos     = 0;
       int64_t pts          = 0;
 
+      bool in_queue = false;
+
+      if (m_seek_burst.start)
+        m_seek_burst.seeks++;
+
       if(m_has_subtitle)
         m_player_subtitles.Pause();
 
@@ -1772,7 +2046,19 @@ int main(int argc, char *argv[])
         seek_pos = (pts ? (double)pts / AV_TIME_BASE : last_seek_pos) + m_incr;
         last_seek_pos = seek_pos;
 
-        if(m_omx_reader.SeekTime(seek_pos, m_incr < 0.0f, &startpts))
+        if(!m_seek_flush && m_incr > 0 && pts && m_av_clock->OMXPlaySpeed() == DVD_PLAYSPEED_NORMAL &&
+           (m_has_video || m_has_audio) && SeekInQueues(seek_pos * AV_TIME_BASE, &startpts))
+        {
+          in_queue = true;
+          unsigned t = (unsigned)(startpts*1e-6);
+          auto dur = m_omx_reader.GetStreamLength() / 1000;
+          string m = strprintf("%02d:%02d:%02d / %02d:%02d:%02d",
+              (t/3600), (t/60)%60, t%60, (dur/3600), (dur/60)%60, dur%60);
+
+          DISPLAY_TEXT_LONG("Seek\n" + m);
+          printf("Seek to: %s (queued)\n", m.c_str());
+        }
+        else if(m_omx_reader.SeekTime(seek_pos, m_incr < 0.0f, &startpts))
         {
           unsigned t = (unsigned)(startpts*1e-6);
           auto dur = m_omx_reader.GetStreamLength() / 1000;
@@ -1783,6 +2069,12 @@ int main(int argc, char *argv[])
           printf("Seek to: %s\n", m.c_str());
           FlushStreams(startpts);
         }
+        else if(m_omx_reader.SeekCancelled())
+        {
+          // a newer request is waiting, fold it in and seek again
+          m_seek_burst.cancelled++;
+          continue;
+        }
       }
 
       sentStarted = false;
@@ -1791,7 +2083,7 @@ int main(int argc, char *argv[])
         goto do_exit;
 
       // Quick reset to reduce delay during loop & seek.
-      if (m_has_video && !m_player_video.Reset())
+      if (!in_queue && m_has_video && !m_player_video.Reset())
         ExitGentlyOnError();
 
       CLog::Log(LOGDEBUG, "Seeked %.0f %lld %lld\n", seek_pos, startpts, m_av_clock->OMXMediaTime());
@@ -1803,6 +2095,8 @@ int main(int argc, char *argv[])
       m_packet_after_seek = false;
       m_seek_flush = false;
       m_incr = 0;
+
+      m_omxcontrol.seeked(startpts);
     }
     else if(m_packet_after_seek && TRICKPLAY(m_av_clock->OMXPlaySpeed()))
     {
@@ -1842,10 +2136,12 @@ int main(int argc, char *argv[])
       {
         static int count;
         if ((count++ & 7) == 0)
-           printf("M:%lld V:%6.2fs %6dk/%6dk A:%6.2f %6.02fs/%6.02fs Cv:%6uk Ca:%6uk                            \r", stamp,
+           printf("M:%lld V:%6.2fs %6dk/%6dk A:%6.2f %6.02fs/%6.02fs Cv:%6uk Ca:%6uk Hv:%5.1fs Ha:%5.1fs Bb:%6uk %3u%%                 \r", stamp,
                video_fifo, (m_player_video.GetDecoderBufferSize()-m_player_video.GetDecoderFreeSpace())>>10, m_player_video.GetDecoderBufferSize()>>10,
                audio_fifo, m_player_audio.GetDelay(), m_player_audio.GetCacheTotal(),
-               m_player_video.GetCached()>>10, m_player_audio.GetCached()>>10);
+               m_player_video.GetCached()>>10, m_player_audio.GetCached()>>10,
+               BacklogBlockedTime(m_video_backlog), BacklogBlockedTime(m_audio_backlog),
+               m_omx_reader.GetBackBufferSize()>>10, m_omx_reader.GetBackBufferHitRate());
       }
 
       if(m_tv_show_info)
@@ -1901,34 +2197,31 @@ int main(int argc, char *argv[])
             {
               CLog::Log(LOGDEBUG, "Resume %.2f,%.2f (%d,%d,%d,%d) EOF:%d PKT:%p\n", audio_fifo, video_fifo, audio_fifo_low, video_fifo_low, audio_fifo_high, video_fifo_high, m_omx_reader.IsEof(), m_omx_pkt);
               m_av_clock->OMXResume();
-              m_latency = latency;
+              m_latency_controller.Reset(latency);
+              SeekBurstSettled();
             }
           }
           else
           {
-            m_latency = m_latency*0.99f + latency*0.01f;
-            float speed = 1.0f;
-            if (m_latency < 0.5f*m_threshold)
-              speed = 0.990f;
-            else if (m_latency < 0.9f*m_threshold)
-              speed = 0.999f;
-            else if (m_latency > 2.0f*m_threshold)
-              speed = 1.010f;
-            else if (m_latency > 1.1f*m_threshold)
-              speed = 1.001f;
-
-            m_av_clock->OMXSetSpeed(S(speed));
-            m_av_clock->OMXSetSpeed(S(speed), true, true);
-            CLog::Log(LOGDEBUG, "Live: %.2f (%.2f) S:%.3f T:%.2f\n", m_latency, latency, speed, m_threshold);
+            int speed = S(m_latency_controller.Update(latency, OMXClock::GetAbsoluteClock()));
+            if (speed != m_av_clock->OMXPlaySpeed())
+            {
+              m_av_clock->OMXSetSpeed(speed);
+              m_av_clock->OMXSetSpeed(speed, true, true);
+            }
+            CLog::Log(LOGDEBUG, "Live: %.2f (%.2f) S:%.3f T:%.2f\n", m_latency_controller.GetLatency(), latency,
+              (float)speed / DVD_PLAYSPEED_NORMAL, m_latency_controller.GetTarget());
           }
         }
       }
-      else if(!m_Pause && (m_omx_reader.IsEof() || m_omx_pkt || TRICKPLAY(m_av_clock->OMXPlaySpeed()) || (audio_fifo_high && video_fifo_high)))
+      else if(!m_Pause && (m_omx_reader.IsEof() || m_omx_pkt ||
+          !m_video_backlog.packets.empty() || !m_audio_backlog.packets.empty() || TRICKPLAY(m_av_clock->OMXPlaySpeed()) || (audio_fifo_high && video_fifo_high)))
       {
         if (m_av_clock->OMXIsPaused())
         {
           CLog::Log(LOGDEBUG, "Resume %.2f,%.2f (%d,%d,%d,%d) EOF:%d PKT:%p\n", audio_fifo, video_fifo, audio_fifo_low, video_fifo_low, audio_fifo_high, video_fifo_high, m_omx_reader.IsEof(), m_omx_pkt);
           m_av_clock->OMXResume();
+          SeekBurstSettled();
         }
       }
       else if (m_Pause || audio_fifo_low || video_fifo_low)
@@ -1949,14 +2242,41 @@ int main(int argc, char *argv[])
       sentStarted = true;
     }
 
+    // Staged packets go first, so each stream drains at its own pace. Only
+    // a full backlog holds up demuxing for the others.
+    if(m_has_video)
+      DrainBacklog(m_video_backlog, m_player_video);
+    if(m_has_audio)
+      DrainBacklog(m_audio_backlog, m_player_audio);
+    {
+      int64_t now = OMXClock::GetAbsoluteClock();
+      bool blocked = BacklogBlocking(m_video_backlog, m_player_video.GetMaxCached() / 4, now);
+      if (BacklogBlocking(m_audio_backlog, m_player_audio.GetMaxCached() / 4, now) || blocked)
+      {
+        m_wait_ms = -1;
+        continue;
+      }
+    }
+
     if(!m_omx_pkt)
+    {
+      if (m_back_buffer > 0.0f)
+        m_omx_reader.SetBackBufferQueued(m_video_backlog.size + m_audio_backlog.size +
+                                         m_player_video.GetCached() + m_player_audio.GetCached());
       m_omx_pkt = m_omx_reader.Read();
+    }
 
     if(m_omx_pkt)
       m_send_eos = false;
 
     if(m_omx_reader.IsEof() && !m_omx_pkt)
     {
+      // EOS must queue behind the staged packets
+      if (!m_video_backlog.packets.empty() || !m_audio_backlog.packets.empty())
+      {
+        m_wait_ms = -1;
+        continue;
+      }
       if (!m_send_eos && m_has_video)
         m_player_video.SubmitEOS();
       if (!m_send_eos && m_has_audio)
@@ -1965,7 +2285,7 @@ int main(int argc, char *argv[])
       if ( (m_has_video && !m_player_video.IsEOS()) ||
            (m_has_audio && !m_player_audio.IsEOS()) )
       {
-        OMXClock::OMXSleep(10);
+        m_wait_ms = 10;
         continue;
       }
 
@@ -1984,17 +2304,13 @@ int main(int argc, char *argv[])
       {
          m_packet_after_seek = true;
       }
-      if(m_player_video.AddPacket(m_omx_pkt))
-        m_omx_pkt = NULL;
-      else
-        OMXClock::OMXSleep(10);
+      StagePacket(m_video_backlog, m_player_video, m_omx_pkt);
+      m_omx_pkt = NULL;
     }
     else if(m_has_audio && m_omx_pkt && !TRICKPLAY(m_av_clock->OMXPlaySpeed()) && m_omx_pkt->codec_type == AVMEDIA_TYPE_AUDIO)
     {
-      if(m_player_audio.AddPacket(m_omx_pkt))
-        m_omx_pkt = NULL;
-      else
-        OMXClock::OMXSleep(10);
+      StagePacket(m_audio_backlog, m_player_audio, m_omx_pkt);
+      m_omx_pkt = NULL;
     }
     else if(m_has_subtitle && m_omx_pkt && !TRICKPLAY(m_av_clock->OMXPlaySpeed()) &&
             m_omx_pkt->codec_type == AVMEDIA_TYPE_SUBTITLE)
@@ -2004,7 +2320,7 @@ int main(int argc, char *argv[])
       if (result)
         m_omx_pkt = NULL;
       else
-        OMXClock::OMXSleep(10);
+        m_wait_ms = 10;
     }
     else
     {
@@ -2014,7 +2330,7 @@ int main(int argc, char *argv[])
         m_omx_pkt = NULL;
       }
       else
-        OMXClock::OMXSleep(10);
+        m_wait_ms = 10;
     }
   }
 
@@ -2089,6 +2405,8 @@ do_exit:
     m_BcmHost.vc_tv_hdmi_power_on_explicit_new(HDMI_MODE_HDMI, (HDMI_RES_GROUP_T)tv_state.display.hdmi.group, tv_state.display.hdmi.mode);
   }
 
+  m_omxcontrol.stopped();
+
   m_player_subtitles.DeInit();
   m_av_clock->OMXStop();
   m_av_clock->OMXStateIdle();
@@ -2102,6 +2420,7 @@ do_exit:
   {
     m_keyboard->Close();
   }
+  m_event_loop.Close();
 
   vc_tv_show_info(0);
 
@@ -0,0 +1,119 @@
+#include "LatencyController.h"
+#include "Test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define STEP 20000 // [us], the main loop period during playback
+
+// A live buffer: data arrives at real time and is played at the
+// controller's speed, so the latency integrates the speed error
+struct Buffer
+{
+  float latency;
+  int64_t now;
+};
+
+static float Step(LatencyController &controller, Buffer &buffer, float measured)
+{
+  float speed = controller.Update(measured, buffer.now);
+  buffer.latency += (1.0f - speed) * STEP * 1e-6f;
+  buffer.now += STEP;
+  return speed;
+}
+
+static void TestStepResponse()
+{
+  LatencyController controller;
+  controller.SetTarget(0.7f);
+  controller.SetMaxDeviation(0.01f);
+  controller.Reset(0.7f);
+
+  // a burst of data doubles the latency
+  Buffer buffer = {1.7f, 1};
+  float max_speed = 0.0f, min_latency = buffer.latency;
+  for(int i = 0; i < 600 * 1000000 / STEP; i++)
+  {
+    float speed = Step(controller, buffer, buffer.latency);
+    max_speed = fmaxf(max_speed, speed);
+    min_latency = fminf(min_latency, buffer.latency);
+    CHECK(speed >= 0.99f - 1e-6f && speed <= 1.01f + 1e-6f);
+  }
+
+  // catches up at the full allowed speed, settles without ringing
+  CHECK_NEAR(max_speed, 1.01f, 1e-6);
+  CHECK(min_latency > 0.65f);
+  CHECK_NEAR(buffer.latency, 0.7f, 0.01f);
+  CHECK_NEAR(controller.GetLatency(), 0.7f, 0.01f);
+}
+
+static void TestAntiWindup()
+{
+  LatencyController controller;
+  controller.SetTarget(0.5f);
+  controller.SetMaxDeviation(0.02f);
+  controller.Reset(0.5f);
+
+  // the latency stays high whatever the speed, e.g. a stalled decoder
+  int64_t now = 1;
+  float speed = 1.0f;
+  for(int i = 0; i < 1000 * 1000000 / STEP; i++, now += STEP)
+    speed = controller.Update(3.0f, now);
+  CHECK_NEAR(speed, 1.02f, 1e-6);
+
+  // once the latency drops below the target the output leaves saturation
+  // within a few filter time constants instead of unwinding a large integral
+  int64_t dropped = now, released = 0;
+  for(int i = 0; i < 60 * 1000000 / STEP && !released; i++, now += STEP)
+    if(controller.Update(0.3f, now) < 1.0f)
+      released = now;
+  CHECK(released != 0);
+  CHECK(released - dropped < 5 * 1000000);
+
+  // and it saturates at the other bound with the same limit
+  for(int i = 0; i < 1000 * 1000000 / STEP; i++, now += STEP)
+    speed = controller.Update(-2.0f, now);
+  CHECK_NEAR(speed, 0.98f, 1e-6);
+}
+
+static void TestJitter()
+{
+  LatencyController controller;
+  controller.SetTarget(1.0f);
+  controller.SetMaxDeviation(0.01f);
+  controller.Reset(1.0f);
+
+  // the fifo based estimate jumps by up to 200ms between samples
+  srand(1);
+  Buffer buffer = {1.0f, 1};
+  double sum = 0.0, sq_sum = 0.0, latency_sum = 0.0;
+  int samples = 0;
+  for(int i = 0; i < 900 * 1000000 / STEP; i++)
+  {
+    float noise = 0.2f * (rand() / (float)RAND_MAX - 0.5f) * 2.0f;
+    float speed = Step(controller, buffer, buffer.latency + noise);
+    CHECK(speed >= 0.99f - 1e-6f && speed <= 1.01f + 1e-6f);
+    if(i >= 300 * 1000000 / STEP)
+    {
+      sum += speed;
+      sq_sum += (double)speed * speed;
+      latency_sum += buffer.latency;
+      samples++;
+    }
+  }
+
+  // the noise is filtered rather than passed on as speed changes
+  double mean = sum / samples;
+  double stddev = sqrt(fmax(sq_sum / samples - mean * mean, 0.0));
+  CHECK_NEAR(mean, 1.0, 1e-3);
+  CHECK(stddev < 0.002);
+  CHECK_NEAR(latency_sum / samples, 1.0, 0.02);
+}
+
+int main()
+{
+  TestStepResponse();
+  TestAntiWindup();
+  TestJitter();
+  TEST_EXIT();
+}
@@ -0,0 +1,150 @@
+#include "utils/Mailbox.h"
+#include "utils/LockBlock.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// The mutex and condition variable mailbox it replaced, for comparison
+template <typename... Ts>
+class LockedMailbox {
+public:
+  template <typename T>
+  void send(T&& msg) {
+    LOCK_BLOCK (messages_lock_) {
+      messages_.push_back(std::forward<T>(msg));
+      messages_cond_.notify_one();
+    }
+  }
+
+  template <typename Rep, typename Period, typename... Funs>
+  void receive_wait(const std::chrono::duration<Rep, Period>& rel_time,
+                    Funs&&... funs)
+  {
+    std::unique_lock<std::mutex> lock(messages_lock_);
+    if (!messages_cond_.wait_for(lock, rel_time, [&]{ return !messages_.empty(); }))
+      return;
+    while (!messages_.empty()) {
+      utils::variant<Ts...> msg(std::move(messages_.front()));
+      messages_.pop_front();
+      lock.unlock();
+      utils::apply_visitor(functor_visitor<Funs&...>(funs...), std::move(msg));
+      lock.lock();
+    }
+  }
+
+private:
+  std::deque<utils::variant<Ts...>> messages_;
+  std::mutex messages_lock_;
+  std::condition_variable messages_cond_;
+};
+
+struct Seq { int producer; int seq; };
+struct Payload { vector<int> data; };
+struct Stop {};
+
+static bool fifo_ok = true;
+
+// Producers send numbered messages as fast as they can while one receiver
+// drains them, checking each producer's messages arrive in order
+template <class MB>
+static void Contention(const char *name, int producers, int messages)
+{
+  MB mailbox;
+  vector<int> last(producers, -1);
+  long received = 0;
+  bool in_order = true;
+
+  auto begin = chrono::steady_clock::now();
+  thread receiver([&]
+  {
+    bool done = false;
+    while (!done)
+      mailbox.receive_wait(chrono::milliseconds(1000),
+        [&](Seq&& m)
+        {
+          if (m.seq != last[m.producer] + 1)
+            in_order = false;
+          last[m.producer] = m.seq;
+          received++;
+        },
+        [&](Payload&&) {},
+        [&](Stop&&) { done = true; });
+  });
+
+  vector<thread> senders;
+  for (int p = 0; p < producers; p++)
+    senders.emplace_back([&, p]
+    {
+      for (int i = 0; i < messages / producers; i++)
+        mailbox.send(Seq{p, i});
+    });
+  for (auto& t : senders)
+    t.join();
+  mailbox.send(Stop{});
+  receiver.join();
+  double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+  for (int p = 0; p < producers; p++)
+    if (last[p] != messages / producers - 1)
+      in_order = false;
+  fifo_ok = fifo_ok && in_order;
+  printf("%-7s %d producers: %ld messages in %7.1fms, %6.1f ns/message, per producer FIFO %s\n",
+         name, producers, received, ms, ms * 1e6 / received, in_order ? "ok" : "BROKEN");
+}
+
+// One message at a time to a sleeping receiver
+template <class MB>
+static void WakeLatency(const char *name)
+{
+  typedef chrono::steady_clock::time_point Sent;
+  MB mailbox;
+  const int count = 2000;
+  atomic<int> seen(0);
+  double total = 0;
+
+  thread receiver([&]
+  {
+    while (seen < count)
+      mailbox.receive_wait(chrono::milliseconds(1000), [&](Sent&& sent)
+      {
+        total += chrono::duration<double, micro>(chrono::steady_clock::now() - sent).count();
+        seen++;
+      });
+  });
+  for (int i = 0; i < count; i++)
+  {
+    mailbox.send(chrono::steady_clock::now());
+    while (seen <= i)
+      this_thread::yield();
+    this_thread::sleep_for(chrono::microseconds(50));
+  }
+  receiver.join();
+  printf("%-7s wake latency %.1fus\n", name, total / count);
+}
+
+int main()
+{
+  for (int producers : {1, 2, 4, 8})
+  {
+    Contention<LockedMailbox<Seq, Payload, Stop>>("locked", producers, 400000);
+    Contention<Mailbox<Seq, Payload, Stop>>("mailbox", producers, 400000);
+  }
+  WakeLatency<LockedMailbox<chrono::steady_clock::time_point>>("locked");
+  WakeLatency<Mailbox<chrono::steady_clock::time_point>>("mailbox");
+
+  // nothing sent, the wait must time out rather than spin or hang
+  Mailbox<Seq> empty;
+  auto begin = chrono::steady_clock::now();
+  empty.receive_wait(chrono::milliseconds(50), [](Seq&&) {});
+  printf("mailbox empty 50ms wait took %.1fms\n",
+         chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count());
+
+  return fifo_ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+#include "SoftClock.h"
+#include "Test.h"
+
+#define SECOND 1000000 // [us]
+#define NORMAL 0x10000
+
+static void TestPauseResume()
+{
+  SoftClock clock;
+  int64_t now = 5 * SECOND;
+  CHECK(!clock.IsRunning());
+  CHECK(clock.GetMediaTime(now) == 0);
+
+  // stands still until started
+  clock.SetMediaTime(SECOND, now);
+  CHECK(clock.GetMediaTime(now + SECOND) == SECOND);
+
+  clock.Start(SECOND, now);
+  CHECK(clock.IsRunning());
+  CHECK(clock.GetMediaTime(now + 2 * SECOND) == 3 * SECOND);
+
+  // pausing at scale 0 keeps the time played so far
+  now += 2 * SECOND;
+  clock.SetScale(0, now);
+  CHECK(clock.GetMediaTime(now + 10 * SECOND) == 3 * SECOND);
+
+  now += 10 * SECOND;
+  clock.SetScale(NORMAL, now);
+  CHECK(clock.GetMediaTime(now + SECOND) == 4 * SECOND);
+
+  // stopping freezes the time where it is
+  now += SECOND;
+  clock.Stop(now);
+  CHECK(!clock.IsRunning());
+  CHECK(clock.GetMediaTime(now + 10 * SECOND) == 4 * SECOND);
+}
+
+static void TestSpeed()
+{
+  SoftClock clock;
+  int64_t now = 0;
+  clock.Start(0, now);
+
+  clock.SetScale(2 * NORMAL, now);
+  CHECK(clock.GetScale() == 2 * NORMAL);
+  CHECK(clock.GetMediaTime(now + SECOND) == 2 * SECOND);
+
+  // a change applies from now on, not to the time already played
+  now += SECOND;
+  clock.SetScale(NORMAL / 2, now);
+  CHECK(clock.GetMediaTime(now + 2 * SECOND) == 3 * SECOND);
+
+  // backwards
+  now += 2 * SECOND;
+  clock.SetScale(-NORMAL, now);
+  CHECK(clock.GetMediaTime(now + SECOND) == 2 * SECOND);
+
+  // a speed slightly off normal, as the latency controller sets, within
+  // the 1/65536 resolution of the scale
+  clock.SetScale(NORMAL, now);
+  clock.SetMediaTime(0, now);
+  clock.SetScale(NORMAL + NORMAL / 100, now);
+  CHECK_NEAR(clock.GetMediaTime(now + 100 * SECOND), 101 * SECOND, 100 * SECOND / NORMAL);
+}
+
+static void TestStep()
+{
+  SoftClock clock;
+  int64_t now = 0;
+  clock.Start(10 * SECOND, now);
+  clock.SetScale(0, now);
+
+  // one frame at 25fps, also while paused
+  clock.Step(1, now + SECOND);
+  CHECK(clock.GetMediaTime(now + SECOND) == 10 * SECOND + SECOND / 25);
+  clock.Step(3, now + 2 * SECOND);
+  CHECK(clock.GetMediaTime(now + 5 * SECOND) == 10 * SECOND + 4 * SECOND / 25);
+
+  // and from where a running clock is
+  clock.SetScale(NORMAL, now + 5 * SECOND);
+  clock.Step(1, now + 6 * SECOND);
+  CHECK(clock.GetMediaTime(now + 6 * SECOND) == 11 * SECOND + 5 * SECOND / 25);
+}
+
+static void TestReference()
+{
+  SoftClock clock;
+  int64_t now = 0;
+
+  // a stopped clock takes the reference as it is
+  clock.Reference(7 * SECOND, now);
+  CHECK(clock.GetMediaTime(now) == 7 * SECOND);
+
+  clock.Start(0, now);
+
+  // small errors are slewed an eighth at a time
+  now += SECOND;
+  clock.Reference(SECOND + 8000, now);
+  CHECK(clock.GetMediaTime(now) == SECOND + 1000);
+  clock.Reference(SECOND - 7000, now);
+  CHECK(clock.GetMediaTime(now) == SECOND);
+
+  // jitter of a few ms around the true time stays within a ms
+  for(int i = 0; i < 100; i++)
+  {
+    now += 20000;
+    clock.Reference(now + (i % 2 ? 4000 : -4000), now);
+    CHECK_NEAR(clock.GetMediaTime(now), now, 1000);
+  }
+
+  // a constant error converges, up to what rounds away in the eighth
+  for(int i = 0; i < 100; i++)
+  {
+    now += 20000;
+    clock.Reference(now + 10000, now);
+  }
+  CHECK_NEAR(clock.GetMediaTime(now), now + 10000, 7);
+
+  // large errors, e.g. after a seek, are jumped
+  now += 20000;
+  clock.Reference(now + 5 * SECOND, now);
+  CHECK(clock.GetMediaTime(now) == now + 5 * SECOND);
+  clock.Reference(now - 30000, now);
+  CHECK(clock.GetMediaTime(now) == now - 30000);
+}
+
+int main()
+{
+  TestPauseResume();
+  TestSpeed();
+  TestStep();
+  TestReference();
+  TEST_EXIT();
+}
@@ -0,0 +1,128 @@
+#include "Srt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const char *lines[] =
+{
+  "I don't think that's a good idea.",
+  "- Where are you going?",
+  "<i>Previously on...</i>",
+  "<font color=\"#ffff00\">[DOOR SLAMS]</font>",
+  "Ça, c'est la vie <3",
+};
+
+static string Timecode(int ms, char separator, int fraction_digits)
+{
+  char buf[32];
+  int fraction = fraction_digits == 2 ? ms % 1000 / 10 : ms % 1000;
+  snprintf(buf, sizeof(buf), "%02d:%02d:%02d%c%0*d", ms / 3600000, ms / 60000 % 60,
+           ms / 1000 % 60, separator, fraction_digits, fraction);
+  return buf;
+}
+
+// A file of the given format with cues of one or two lines, every 50th of
+// them starting before the one it follows
+static string Generate(const string& extension, int cues)
+{
+  string text;
+  if(extension == ".vtt")
+    text += "WEBVTT\n\n";
+  else if(extension == ".ass")
+    text += "[Script Info]\nScriptType: v4.00+\n\n[Events]\n"
+            "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+
+  srand(1);
+  int time = 0;
+  for(int i = 0; i < cues; i++)
+  {
+    time += 500 + rand() % 3000;
+    int start = i % 50 == 49 ? time - 4000 : time;
+    int stop = start + 1000 + rand() % 2000;
+    string first = lines[rand() % 5];
+    string second = rand() % 2 ? lines[rand() % 5] : "";
+
+    if(extension == ".ass")
+    {
+      text += "Dialogue: 0," + Timecode(start, '.', 2).substr(1) + "," + Timecode(stop, '.', 2).substr(1) +
+              ",Default,,0,0,0,," + first + (second.empty() ? "" : "\\N" + second) + "\n";
+    }
+    else
+    {
+      char separator = extension == ".vtt" ? '.' : ',';
+      text += to_string(i + 1) + "\n" + Timecode(start, separator, 3) + " --> " + Timecode(stop, separator, 3) +
+              "\n" + first + "\n" + (second.empty() ? "" : second + "\n") + "\n";
+    }
+  }
+  return text;
+}
+
+// Reads the file the way the render loop does, 256 cues per turn
+static void Bench(const string& filename, size_t bytes, int passes)
+{
+  size_t cues = 0;
+  auto begin = chrono::steady_clock::now();
+  for(int pass = 0; pass < passes; pass++)
+  {
+    SubtitleFileReader reader;
+    vector<Subtitle> subs;
+    if(!reader.Open(filename))
+    {
+      printf("%s: could not open\n", filename.c_str());
+      exit(1);
+    }
+    while(reader.Read(subs, 256))
+      ;
+    cues = subs.size();
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count() / passes;
+
+  printf("%-24s %5.1fMB %6zu cues %7.1fms %6.0f MB/s\n", filename.substr(filename.rfind('/') + 1).c_str(),
+         bytes / 1e6, cues, seconds * 1e3, bytes / seconds / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+  int passes = 5;
+
+  // Files given on the command line, or generated ones of 60000 cues
+  if(argc > 1)
+  {
+    for(int i = 1; i < argc; i++)
+    {
+      FILE *f = fopen(argv[i], "rb");
+      if(!f)
+      {
+        printf("%s: could not open\n", argv[i]);
+        return 1;
+      }
+      fseek(f, 0, SEEK_END);
+      size_t bytes = ftell(f);
+      fclose(f);
+      Bench(argv[i], bytes, passes);
+    }
+    return 0;
+  }
+
+  for(const char *extension : {".srt", ".vtt", ".ass"})
+  {
+    string text = Generate(extension, 60000);
+    string filename = string("/tmp/SubtitleFileReaderBench") + extension;
+    FILE *f = fopen(filename.c_str(), "wb");
+    if(!f || fwrite(text.data(), 1, text.size(), f) != text.size())
+    {
+      printf("%s: could not write\n", filename.c_str());
+      return 1;
+    }
+    fclose(f);
+    Bench(filename, text.size(), passes);
+    unlink(filename.c_str());
+  }
+  return 0;
+}
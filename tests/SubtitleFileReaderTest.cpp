@@ -0,0 +1,110 @@
+#include "Srt.h"
+#include "Test.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Run from the top of the tree, as make test does
+static const string fixtures = "tests/subtitles/";
+
+struct Cue
+{
+  int start;
+  int stop;
+  vector<string> lines;
+};
+
+static bool Same(const vector<Subtitle>& subs, const vector<Cue>& cues)
+{
+  if(subs.size() != cues.size())
+  {
+    printf("%zu cues, expected %zu\n", subs.size(), cues.size());
+    return false;
+  }
+  for(size_t i = 0; i < cues.size(); i++)
+  {
+    if(subs[i].start != cues[i].start || subs[i].stop != cues[i].stop ||
+       subs[i].text_lines() != cues[i].lines)
+    {
+      printf("cue %zu is %d-%d \"%s\", expected %d-%d \"%s\"\n", i,
+             subs[i].start, subs[i].stop,
+             subs[i].text_lines().empty() ? "" : subs[i].text_lines()[0].c_str(),
+             cues[i].start, cues[i].stop,
+             cues[i].lines.empty() ? "" : cues[i].lines[0].c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the whole file max_cues at a time, checking cues come out in order
+// until the final Read sorts them
+static vector<Subtitle> ReadAll(const string& name, size_t max_cues, bool& reordered)
+{
+  SubtitleFileReader reader;
+  vector<Subtitle> subs;
+  CHECK(reader.Open(fixtures + name));
+
+  int reads = 0;
+  while(reader.Read(subs, max_cues))
+  {
+    CHECK(!reader.Reordered());
+    for(size_t i = 1; i < subs.size(); i++)
+      CHECK(subs[i - 1].start <= subs[i].start);
+    CHECK(++reads < 100);
+  }
+  reordered = reader.Reordered();
+  return subs;
+}
+
+static void TestFile(const string& name, const vector<Cue>& cues, bool reordered)
+{
+  for(size_t max_cues : {(size_t) 1, (size_t) 2, (size_t) 256})
+  {
+    bool sorted;
+    vector<Subtitle> subs = ReadAll(name, max_cues, sorted);
+    CHECK(Same(subs, cues));
+    CHECK(sorted == reordered);
+  }
+}
+
+int main()
+{
+  // BOM, CRLF line ends, a nested cue, a cue out of order and short fractions
+  TestFile("sample.srt", {
+    {1000, 2500, {"Hello, world."}},
+    {2000, 2800, {"Out of order"}},
+    {3000, 6000, {"<i>Two</i>", "lines"}},
+    {4000, 5000, {"Nested in the one before"}},
+    {3723400, 3724560, {"Short fractions"}},
+  }, true);
+
+  // Header, STYLE and NOTE blocks, cue ids, cue settings and optional hours
+  TestFile("sample.vtt", {
+    {1000, 2000, {"No hours"}},
+    {3250, 4750, {"<v Roger>Hours and", "a second line"}},
+    {3600000, 3601500, {"One digit hours"}},
+  }, false);
+
+  // Fields in the order of the [Events] Format line, commas in the text,
+  // \N line breaks, Comment lines, empty text and a line out of order
+  TestFile("sample.ass", {
+    {500, 900, {"Early"}},
+    {1000, 2500, {"Commas, in the text, stay"}},
+    {3000, 5000, {"{\\i1}First{\\i0}", "Second"}},
+  }, true);
+
+  SubtitleFileReader reader;
+  CHECK(!reader.Open(fixtures + "missing.srt"));
+
+  // An empty file has no cues
+  vector<Subtitle> subs;
+  CHECK(reader.Open("/dev/null"));
+  CHECK(!reader.Read(subs, 256));
+  CHECK(subs.empty());
+
+  TEST_EXIT();
+}
@@ -0,0 +1,190 @@
+#include "SubtitleIndex.h"
+#include "Test.h"
+
+#include <stdlib.h>
+#include <set>
+
+using namespace std;
+
+static Subtitle Cue(int start, int stop)
+{
+  return Subtitle(start, stop, vector<string>());
+}
+
+static vector<size_t> LinearFind(const vector<Subtitle>& subs, int time)
+{
+  vector<size_t> found;
+  for(size_t i = 0; i < subs.size(); i++)
+    if(subs[i].start <= time && time < subs[i].stop)
+      found.push_back(i);
+  return found;
+}
+
+static size_t LinearUpperBound(const vector<Subtitle>& subs, int time)
+{
+  size_t i = 0;
+  while(i < subs.size() && subs[i].start <= time)
+    i++;
+  return i;
+}
+
+// Every time where the answer can change, and the ones either side of it
+static set<int> ProbeTimes(const vector<Subtitle>& subs)
+{
+  set<int> times;
+  for(auto& sub : subs)
+    for(int t : {sub.start, sub.stop})
+      for(int d = -1; d <= 1; d++)
+        times.insert(t + d);
+  return times;
+}
+
+static void CheckAgainstLinear(const SubtitleIndex& index, const vector<Subtitle>& subs)
+{
+  CHECK(index.Size() == subs.size());
+
+  vector<size_t> found;
+  for(int time : ProbeTimes(subs))
+  {
+    index.Find(time, found);
+    CHECK(found == LinearFind(subs, time));
+    CHECK(index.UpperBound(time) == LinearUpperBound(subs, time));
+  }
+}
+
+// Cues in start order, with zero length ones, identical starts, nesting
+// and a few that span most of the file
+static vector<Subtitle> RandomCues(size_t count)
+{
+  vector<Subtitle> subs;
+  int start = 0;
+  for(size_t i = 0; i < count; i++)
+  {
+    if(rand() % 4)
+      start += rand() % 3000;
+    int length;
+    switch(rand() % 8)
+    {
+      case 0:  length = 0; break;
+      case 1:  length = 200000 + rand() % 500000; break;
+      default: length = 500 + rand() % 4000; break;
+    }
+    subs.push_back(Cue(start, start + length));
+  }
+  return subs;
+}
+
+static void TestEmpty()
+{
+  SubtitleIndex index;
+  vector<size_t> found(1);
+  index.Find(0, found);
+  CHECK(found.empty());
+  CHECK(index.UpperBound(0) == 0);
+  CHECK(index.Size() == 0);
+}
+
+static void TestShapes()
+{
+  vector<Subtitle> subs = {
+    Cue(0, 10000),     // spans everything below
+    Cue(1000, 5000),   // nested in the first
+    Cue(1000, 2000),   // same start, nested in both
+    Cue(1000, 1000),   // zero length, never shows
+    Cue(2000, 2000),   // zero length at another cue's stop
+    Cue(2000, 3000),   // starts as its neighbour stops
+    Cue(9999, 20000),  // overlaps the end of the first
+  };
+  SubtitleIndex index;
+  index.Assign(subs);
+  CheckAgainstLinear(index, subs);
+
+  vector<size_t> found;
+  index.Find(1000, found);
+  CHECK((found == vector<size_t>{0, 1, 2}));
+  index.Find(2000, found);
+  CHECK((found == vector<size_t>{0, 1, 5}));
+  index.Find(9999, found);
+  CHECK((found == vector<size_t>{0, 6}));
+  index.Find(10000, found);
+  CHECK((found == vector<size_t>{6}));
+  CHECK(index.UpperBound(999) == 1);
+  CHECK(index.UpperBound(1000) == 4);
+}
+
+// The leaves double at 64 and 128 cues, check either side of both
+static void TestGrowBoundaries()
+{
+  for(size_t count : {1, 63, 64, 65, 127, 128, 129, 300})
+  {
+    vector<Subtitle> subs = RandomCues(count);
+    SubtitleIndex index;
+    index.Assign(subs);
+    CheckAgainstLinear(index, subs);
+  }
+
+  // a cue that outlasts everything must survive the rebuilds
+  vector<Subtitle> subs = {Cue(0, 1000000)};
+  for(int i = 1; i < 200; i++)
+    subs.push_back(Cue(i * 1000, i * 1000 + 500));
+  SubtitleIndex index;
+  index.Assign(subs);
+  CheckAgainstLinear(index, subs);
+}
+
+// Appending one cue at a time, as the demuxer does, matches Assign at
+// every step, including across the rebuilds
+static void TestAppend()
+{
+  vector<Subtitle> subs = RandomCues(140);
+  SubtitleIndex appended;
+  vector<Subtitle> prefix;
+  for(auto& sub : subs)
+  {
+    appended.Append(sub);
+    prefix.push_back(sub);
+
+    SubtitleIndex assigned;
+    assigned.Assign(prefix);
+
+    vector<size_t> found_appended, found_assigned;
+    for(int time : ProbeTimes(prefix))
+    {
+      appended.Find(time, found_appended);
+      assigned.Find(time, found_assigned);
+      CHECK(found_appended == found_assigned);
+    }
+    if(prefix.size() % 16 == 0 || prefix.size() == 64 || prefix.size() == 128)
+      CheckAgainstLinear(appended, prefix);
+  }
+
+  // and the index can be reused after Clear
+  appended.Clear();
+  CHECK(appended.Size() == 0);
+  vector<Subtitle> more = RandomCues(70);
+  for(auto& sub : more)
+    appended.Append(sub);
+  CheckAgainstLinear(appended, more);
+}
+
+static void TestRandom()
+{
+  for(int round = 0; round < 50; round++)
+  {
+    vector<Subtitle> subs = RandomCues(rand() % 1000);
+    SubtitleIndex index;
+    index.Assign(subs);
+    CheckAgainstLinear(index, subs);
+  }
+}
+
+int main()
+{
+  srand(1);
+  TestEmpty();
+  TestShapes();
+  TestGrowBoundaries();
+  TestAppend();
+  TestRandom();
+  TEST_EXIT();
+}
@@ -0,0 +1,55 @@
+#include "SubtitleTags.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+// Lines as found in real subtitle files, most plain, some styled
+static const char *samples[] =
+{
+  "I don't think that's a good idea.",
+  "- Where are you going?",
+  "- Out.",
+  "<i>Previously on...</i>",
+  "<font color=\"#ffff00\">[DOOR SLAMS]</font>",
+  "{\\an8}{\\i1}Somewhere in the north{\\i0}",
+  "<b>WARNING</b> <i>contains</i> {\\c&H00FFFF&}colour{\\c}",
+  "Ça, c'est la vie <3",
+};
+
+int main(int argc, char *argv[])
+{
+  int passes = argc > 1 ? atoi(argv[1]) : 50;
+
+  vector<string> lines;
+  size_t bytes = 0;
+  srand(1);
+  for(int i = 0; i < 20000; i++)
+  {
+    lines.push_back(samples[rand() % (sizeof(samples) / sizeof(*samples))]);
+    bytes += lines.back().size();
+  }
+
+  vector<SubtitleTextRun> runs;
+  size_t total_runs = 0;
+  auto begin = chrono::steady_clock::now();
+  for(int pass = 0; pass < passes; pass++)
+  {
+    SubtitleTagState state;
+    for(const string &line : lines)
+    {
+      runs.clear();
+      tokenize_subtitle_line(line.data(), line.size(), state, runs);
+      total_runs += runs.size();
+    }
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+  size_t count = lines.size() * passes;
+  printf("tokenize_subtitle_line: %zu lines, %zu runs, %.1f ns/line, %.0f MB/s\n",
+         count, total_runs, seconds * 1e9 / count, bytes * passes / seconds / 1e6);
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include "SubtitleTags.h"
+#include "Test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+using namespace std;
+
+// Runs written as [style]text, style being b, i and :rrggbb
+static string Describe(const vector<SubtitleTextRun> &runs)
+{
+  string out;
+  for(const SubtitleTextRun &run : runs)
+  {
+    char color[16] = "";
+    if(run.color >= 0)
+      snprintf(color, sizeof(color), ":%06x", run.color);
+    out += "[";
+    out += run.bold ? "b" : "";
+    out += run.italic ? "i" : "";
+    out += color;
+    out += "]";
+    out.append(run.text, run.length);
+  }
+  return out;
+}
+
+struct Case
+{
+  const char *lines[3];
+  const char *expected[3];
+};
+
+static const Case corpus[] =
+{
+  // plain text, trimmed
+  {{"Hello world"}, {"[]Hello world"}},
+  {{"  \t padded \r"}, {"[]padded"}},
+  {{""}, {""}},
+  {{"<i>ça va</i>"}, {"[i]ça va"}},
+
+  // basic and mixed-case tags
+  {{"<b>bold</b> plain"}, {"[b]bold[] plain"}},
+  {{"<B>bold</B><I>it</i>"}, {"[b]bold[i]it"}},
+  {{"<b><i>both</i></b>"}, {"[bi]both"}},
+  {{"{\\b1}bold{\\b0} {\\i1}it{\\i0}"}, {"[b]bold[] [i]it"}},
+  {{"{\\B1}x{\\I1}y"}, {"[b]x[bi]y"}},
+  {{"</b>close without open"}, {"[]close without open"}},
+
+  // colours
+  {{"<font color=\"#ff0000\">red</font> plain"}, {"[:ff0000]red[] plain"}},
+  {{"<FONT COLOR='00FF00'>green</FONT>"}, {"[:00ff00]green"}},
+  {{"<font face=\"x\" color = #0000aa size=2>blue"}, {"[:0000aa]blue"}},
+  {{"{\\c&H0000FF&}red{\\c}plain"}, {"[:ff0000]red[]plain"}},
+  {{"{\\c&hff8000&}azure"}, {"[:0080ff]azure"}},
+
+  // malformed colours leave the colour alone
+  {{"<font color=\"#GG0000\">x</font>"}, {"[]x"}},
+  {{"<font color=#12345>x"}, {"[]x"}},
+  {{"<font size=3>x</font>"}, {"[]x"}},
+  {{"<font color=>x"}, {"[]x"}},
+  {{"{\\c&H12345&}x"}, {"[]x"}},
+  {{"{\\c&H0000FF}x"}, {"[]x"}},
+  {{"{\\c&HGG0000&}x"}, {"[]x"}},
+  {{"<font color=\"#ff0000\">a<font color=\"#zz\">b</font>c"}, {"[:ff0000]a[:ff0000]b[]c"}},
+
+  // stray '<', '{' and '\' are text, anything closed is a tag
+  {{"a < b"}, {"[]a < b"}},
+  {{"a < b > c"}, {"[]a [] c"}},
+  {{"<<b>x"}, {"[]x"}},
+  {{"x <"}, {"[]x <"}},
+  {{"{not a tag}"}, {"[]{not a tag}"}},
+  {{"{\\unclosed"}, {"[]{\\unclosed"}},
+  {{"back\\slash \\N"}, {"[]back\\slash \\N"}},
+  {{"{\\pos(1,2)}{\\an8}top"}, {"[]top"}},
+  {{"<u>under</u><>"}, {"[]under"}},
+  {{"{}{\\}x"}, {"[]{}[]x"}},
+
+  // state carries over to the following lines
+  {{"<i>first", "second</i>", "third"}, {"[i]first", "[i]second", "[]third"}},
+  {{"{\\c&H00FF00&}one", "two{\\c}"}, {"[:00ff00]one", "[:00ff00]two"}},
+};
+
+static void TestCorpus()
+{
+  for(const Case &c : corpus)
+  {
+    SubtitleTagState state;
+    for(int i = 0; i < 3 && c.lines[i]; i++)
+    {
+      vector<SubtitleTextRun> runs;
+      tokenize_subtitle_line(c.lines[i], strlen(c.lines[i]), state, runs);
+      string got = Describe(runs);
+      if(got != c.expected[i])
+        printf("\"%s\" gives \"%s\", expected \"%s\"\n", c.lines[i], got.c_str(), c.expected[i]);
+      CHECK(got == c.expected[i]);
+    }
+  }
+}
+
+// Tags cut off by the end of the line must not be read past it
+static void TestBounds()
+{
+  const char *text = "<font color=#ff0000>{\\c&H0000FF&}<b>";
+  for(size_t length = 0; length <= strlen(text); length++)
+  {
+    // not terminated, so that a sanitizer catches any overread
+    vector<char> copy(text, text + length);
+    SubtitleTagState state;
+    vector<SubtitleTextRun> runs;
+    tokenize_subtitle_line(copy.data(), copy.size(), state, runs);
+    for(const SubtitleTextRun &run : runs)
+      CHECK(run.text >= copy.data() && run.text + run.length <= copy.data() + copy.size());
+  }
+}
+
+int main()
+{
+  TestCorpus();
+  TestBounds();
+  TEST_EXIT();
+}
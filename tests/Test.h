@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdio.h>
+
+// Minimal checks for the standalone test programs, a failed CHECK is
+// reported and counted, and TEST_EXIT turns the count into the exit status
+static int test_failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if(!(cond)) \
+    { \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test_failures++; \
+    } \
+  } while(0)
+
+#define CHECK_NEAR(a, b, eps) \
+  do { \
+    double a_ = (a), b_ = (b); \
+    if(!(a_ - b_ <= (eps) && b_ - a_ <= (eps))) \
+    { \
+      printf("%s:%d: CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #a, #b, a_, b_); \
+      test_failures++; \
+    } \
+  } while(0)
+
+#define TEST_EXIT() \
+  do { \
+    printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "passed"); \
+    return test_failures ? 1 : 0; \
+  } while(0)
@@ -0,0 +1,104 @@
+// Measures the rate of blocking DBus calls the stub player answers, and
+// what a dashboard refresh costs with one Get per property versus GetAll
+
+#include <dbus/dbus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+
+using namespace std;
+
+static const char *DEST       = "org.mpris.MediaPlayer2.omxplayer";
+static const char *PATH       = "/org/mpris/MediaPlayer2";
+static const char *PROPERTIES = "org.freedesktop.DBus.Properties";
+static const char *PLAYER     = "org.mpris.MediaPlayer2.Player";
+
+static DBusConnection *bus;
+static int failures;
+
+static void Call(const char *interface, const char *member, const char *arg1 = NULL, const char *arg2 = NULL)
+{
+  DBusMessage *m = dbus_message_new_method_call(DEST, PATH, interface, member);
+  if (arg1)
+    dbus_message_append_args(m, DBUS_TYPE_STRING, &arg1, DBUS_TYPE_INVALID);
+  if (arg2)
+    dbus_message_append_args(m, DBUS_TYPE_STRING, &arg2, DBUS_TYPE_INVALID);
+
+  DBusError error;
+  dbus_error_init(&error);
+  DBusMessage *reply = dbus_connection_send_with_reply_and_block(bus, m, 5000, &error);
+  if (reply)
+    dbus_message_unref(reply);
+  else
+  {
+    if (failures++ == 0)
+      fprintf(stderr, "%s %s: %s\n", member, arg2 ? arg2 : "", error.message);
+    dbus_error_free(&error);
+  }
+  dbus_message_unref(m);
+}
+
+// Seconds per call
+template <class F>
+static double Time(int calls, F f)
+{
+  auto begin = chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++)
+    f();
+  return chrono::duration<double>(chrono::steady_clock::now() - begin).count() / calls;
+}
+
+int main(int argc, char **argv)
+{
+  int calls = argc > 1 ? atoi(argv[1]) : 5000;
+
+  DBusError error;
+  dbus_error_init(&error);
+  bus = dbus_bus_get(DBUS_BUS_SESSION, &error);
+  if (!bus)
+  {
+    fprintf(stderr, "CallRateBench: %s\n", error.message);
+    return 1;
+  }
+
+  // The player may still be starting up
+  for (int i = 0; !dbus_bus_name_has_owner(bus, DEST, NULL); i++)
+  {
+    if (i == 50)
+    {
+      fprintf(stderr, "CallRateBench: %s is not on the bus\n", DEST);
+      return 1;
+    }
+    usleep(100000);
+  }
+
+  // The first and last properties registered, and the two the old
+  // strcmp chain reached last
+  const char *properties[] = {"CanGoNext", "Position", "ResHeight", "Duration"};
+  for (const char *property : properties)
+  {
+    double t = Time(calls, [&]{ Call(PROPERTIES, "Get", PLAYER, property); });
+    printf("Get %-10s %8.0f calls/s\n", property, 1 / t);
+  }
+
+  const char *dashboard[] = {"PlaybackStatus", "Rate", "Volume", "Metadata",
+                             "Position", "MinimumRate", "MaximumRate", "CanSeek",
+                             "CanPlay", "CanPause", "Duration", "ResHeight"};
+  double separate = Time(calls / 10, [&]{
+    for (const char *property : dashboard)
+      Call(PROPERTIES, "Get", PLAYER, property);
+  });
+  double all = Time(calls / 10, [&]{ Call(PROPERTIES, "GetAll", PLAYER); });
+  printf("dashboard refresh, 12 Gets: %.3fms\n", separate * 1000);
+  printf("dashboard refresh, GetAll:  %.3fms\n", all * 1000);
+
+  Call("org.mpris.MediaPlayer2", "Quit");
+
+  if (failures)
+  {
+    fprintf(stderr, "CallRateBench: %d calls failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,42 @@
+// Serves omxplayer's DBus interfaces with stub player objects until it is
+// sent Quit, for tests/dbus/bench.sh
+
+#include "OMXControl.h"
+#include "KeyConfig.h"
+
+#include <poll.h>
+#include <stdio.h>
+
+int main()
+{
+  OMXClock clock;
+  OMXPlayerAudio audio;
+  OMXPlayerSubtitles subtitles;
+  OMXReader reader;
+  OMXControl control;
+  std::string name = "org.mpris.MediaPlayer2.omxplayer";
+
+  if (control.init(&clock, &audio, &subtitles, &reader, name) < 0)
+  {
+    fprintf(stderr, "StubPlayer: could not connect to the session bus\n");
+    return 1;
+  }
+  control.trackChanged();
+
+  for (;;)
+  {
+    pollfd fd = {control.getFd(), POLLIN, 0};
+    if (control.pending() || poll(&fd, 1, 20) > 0)
+    {
+      do
+      {
+        if (control.getEvent().getKey() == KeyConfig::ACTION_EXIT)
+        {
+          control.stopped();
+          return 0;
+        }
+      } while (control.pending());
+    }
+    control.update(false);
+  }
+}
@@ -0,0 +1,18 @@
+#!/bin/bash
+# Runs CallRateBench against StubPlayer on a private session bus, so that
+# it neither needs nor disturbs a desktop session. Build both first with
+# make bench-dbus, which also runs this.
+
+dir=$(dirname "$0")
+
+bus=$(dbus-daemon --session --fork --print-address=1 --print-pid=1) || exit 1
+export DBUS_SESSION_BUS_ADDRESS=$(echo "$bus" | sed -n 1p)
+trap 'kill $(echo "$bus" | sed -n 2p)' EXIT
+
+"$dir/StubPlayer" &
+player=$!
+if ! "$dir/CallRateBench" "$@"; then
+  kill $player
+  exit 1
+fi
+wait $player
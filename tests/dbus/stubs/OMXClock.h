@@ -0,0 +1,22 @@
+#pragma once
+
+// Stands in for the player objects OMXControl talks to, so that it can be
+// benchmarked on a machine without the VideoCore libraries
+
+#include <stdint.h>
+#include <unistd.h>
+
+#define DVD_PLAYSPEED_NORMAL 1000
+
+class OMXClock
+{
+public:
+  double OMXMediaTime()                   { return m_time += 1000; }
+  bool OMXIsPaused()                      { return false; }
+  int OMXPlaySpeed()                      { return m_speed; }
+  bool OMXSetSpeed(int speed, bool, bool) { m_speed = speed; return true; }
+
+private:
+  double m_time = 0;
+  int m_speed = DVD_PLAYSPEED_NORMAL;
+};
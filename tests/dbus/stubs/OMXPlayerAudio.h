@@ -0,0 +1,14 @@
+#pragma once
+
+#include "OMXReader.h"
+
+class OMXPlayerAudio
+{
+public:
+  float GetVolume()             { return m_volume; }
+  void SetVolume(float fVolume) { m_volume = fVolume; }
+  void SetMute(bool)            {}
+
+private:
+  float m_volume = 1.0f;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+
+class OMXPlayerSubtitles
+{
+public:
+  size_t GetActiveStream()            { return 0; }
+  void SetActiveStream(size_t)        {}
+  void SetVisible(bool)               {}
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <limits.h>
+#include <string>
+
+enum OMXStreamType
+{
+  OMXSTREAM_NONE      = 0,
+  OMXSTREAM_AUDIO     = 1,
+  OMXSTREAM_VIDEO     = 2,
+  OMXSTREAM_SUBTITLE  = 3
+};
+
+// A 90 minute 1080p file with two audio and two subtitle streams
+class OMXReader
+{
+public:
+  bool CanSeek()              { return true; }
+  std::string getFilename()   { return "/tmp/movie.mkv"; }
+  int GetStreamLength()       { return 90 * 60 * 1000; }
+  double GetAspectRatio()     { return 16.0 / 9; }
+  int GetWidth()              { return 1920; }
+  int GetHeight()             { return 1080; }
+  int VideoStreamCount()      { return 1; }
+  int AudioStreamCount()      { return 2; }
+  int SubtitleStreamCount()   { return 2; }
+  int GetVideoIndex()         { return 0; }
+  int GetAudioIndex()         { return 0; }
+  int GetSubtitleIndex()      { return 0; }
+  bool SetActiveStream(OMXStreamType, unsigned int) { return true; }
+  std::string GetStreamLanguage(OMXStreamType, unsigned int) { return "eng"; }
+  std::string GetStreamName(OMXStreamType, unsigned int)     { return ""; }
+  std::string GetCodecName(OMXStreamType, unsigned int)      { return "h264"; }
+};
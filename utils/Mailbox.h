@@ -28,42 +28,57 @@
 
 #include <type_traits>
 #include <utility>
-#include <deque>
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "variant.hpp"
-#include "LockBlock.h"
 #include "FunctorVisitor.h"
 
+// Any number of threads may send, one thread receives. Senders push onto a
+// lock-free stack, the receiver takes the whole stack at once and handles it
+// in the order sent. A sleeping receiver is woken with a futex.
 template <typename... Ts>
 class Mailbox {
 public:
+  Mailbox() : head_(nullptr), waiting_(0), pending_(nullptr) {}
+  Mailbox(const Mailbox&) = delete;
+  Mailbox& operator=(const Mailbox&) = delete;
+
+  ~Mailbox() {
+    free_list(head_.load(std::memory_order_acquire));
+    free_list(pending_);
+  }
+
   template <typename T>
   void send(T&& msg) {
-    LOCK_BLOCK (messages_lock_) {
-      messages_.push_back(std::forward<T>(msg));
-      messages_cond_.notify_one();
-    }
+    Node* node = new Node(std::forward<T>(msg));
+    Node* head = head_.load(std::memory_order_relaxed);
+    do {
+      node->next = head;
+    } while (!head_.compare_exchange_weak(head, node));
+
+    if (waiting_.load() && waiting_.exchange(0))
+      futex(FUTEX_WAKE_PRIVATE, 1, nullptr);
   }
 
   template <typename... Funs>
   void receive(Funs&&... funs) {
     for (;;) {
-      LOCK_BLOCK (messages_lock_)
-        if (messages_.empty()) break;
-
-      auto extract_message = [&]() {
-        LOCK_BLOCK (messages_lock_) {
-          utils::variant<Ts...> msg(std::move(messages_.front()));
-          messages_.pop_front();
-          return msg;
-        }
-        assert(0);
-      };
+      if (!pending_) {
+        pending_ = take_all();
+        if (!pending_) break;
+      }
 
+      std::unique_ptr<Node> node(pending_);
+      pending_ = node->next;
       utils::apply_visitor(functor_visitor<Funs&...>(funs...),
-                           extract_message());
+                           std::move(node->msg));
     }
   }
 
@@ -71,24 +86,69 @@ public:
   void receive_wait(const std::chrono::duration<Rep, Period>& rel_time,
                     Funs&&... funs)
   {
-    {
-      std::unique_lock<std::mutex> lock(messages_lock_);
-      if (!messages_cond_.wait_for(lock,
-                                   rel_time,
-                                   [&]{return !messages_.empty();}))
+    auto deadline = std::chrono::steady_clock::now() + rel_time;
+    while (!pending_ && !head_.load(std::memory_order_acquire)) {
+      auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+      if (left <= 0)
         return;
+
+      // Senders check the flag after pushing, so either they see it or
+      // the check of head_ below sees their message
+      waiting_.store(1);
+      if (!head_.load()) {
+        timespec ts;
+        ts.tv_sec = left / 1000000000;
+        ts.tv_nsec = left % 1000000000;
+        futex(FUTEX_WAIT_PRIVATE, 1, &ts);
+      }
+      waiting_.store(0, std::memory_order_relaxed);
     }
     receive(std::forward<Funs>(funs)...);
   }
 
+  // Drops the messages the receiver hasn't picked up yet
   void clear() {
-    LOCK_BLOCK(messages_lock_)
-      messages_.clear();
+    free_list(head_.exchange(nullptr, std::memory_order_acquire));
   }
 
 
 private:
-  std::deque<utils::variant<Ts...>> messages_;
-  std::mutex messages_lock_;
-  std::condition_variable messages_cond_;
+  struct Node {
+    template <typename T>
+    explicit Node(T&& msg) : next(nullptr), msg(std::forward<T>(msg)) {}
+
+    Node* next;
+    utils::variant<Ts...> msg;
+  };
+
+  // Returns the messages sent so far, oldest first
+  Node* take_all() {
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    Node* reversed = nullptr;
+    while (node) {
+      Node* next = node->next;
+      node->next = reversed;
+      reversed = node;
+      node = next;
+    }
+    return reversed;
+  }
+
+  static void free_list(Node* node) {
+    while (node) {
+      Node* next = node->next;
+      delete node;
+      node = next;
+    }
+  }
+
+  void futex(int op, int val, const timespec* timeout) {
+    syscall(SYS_futex, reinterpret_cast<int*>(&waiting_), op, val,
+            timeout, nullptr, 0);
+  }
+
+  std::atomic<Node*> head_;
+  std::atomic<int> waiting_;
+  Node* pending_;
 };